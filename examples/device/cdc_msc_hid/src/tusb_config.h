@@ -81,9 +81,16 @@
 
 //------------- CDC -------------//
 
+#if CFG_TUSB_RHPORT0_MODE & OPT_MODE_HIGH_SPEED
+// Bulk endpoint is 512 bytes at high speed, FIFO must hold at least a packet
+#define CFG_TUD_CDC_EPSIZE          512
+#define CFG_TUD_CDC_RX_BUFSIZE      512
+#define CFG_TUD_CDC_TX_BUFSIZE      512
+#else
 // FIFO size of CDC TX and RX
 #define CFG_TUD_CDC_RX_BUFSIZE      64
 #define CFG_TUD_CDC_TX_BUFSIZE      64
+#endif
 
 //------------- MSC -------------//
 
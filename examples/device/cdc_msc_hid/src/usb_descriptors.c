@@ -124,27 +124,75 @@ enum
   #define EPNUM_MSC   0x03
 #endif
 
-uint8_t const desc_configuration[] =
-{
-  // Interface count, string index, total length, attribute, power in mA
-  TUD_CONFIG_DESCRIPTOR(ITF_NUM_TOTAL, 0, CONFIG_TOTAL_LEN, TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP, 100),
+// Configuration with bulk endpoint size and HID polling interval depending on speed
+#define DESC_CONFIGURATION(_bulk_epsize, _hid_interval) \
+  /* Interface count, string index, total length, attribute, power in mA */ \
+  TUD_CONFIG_DESCRIPTOR(ITF_NUM_TOTAL, 0, CONFIG_TOTAL_LEN, TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP, 100), \
+  DESC_CDC(_bulk_epsize) \
+  DESC_MSC(_bulk_epsize) \
+  DESC_HID(_hid_interval)
 
 #if CFG_TUD_CDC
   // Interface number, string index, EP notification address and size, EP data address (out, in) and size.
-  TUD_CDC_DESCRIPTOR(ITF_NUM_CDC, 4, 0x81, 8, 0x02, 0x82, 64),
+  #define DESC_CDC(_epsize)  TUD_CDC_DESCRIPTOR(ITF_NUM_CDC, 4, 0x81, 8, 0x02, 0x82, _epsize),
+#else
+  #define DESC_CDC(_epsize)
 #endif
 
 #if CFG_TUD_MSC
   // Interface number, string index, EP Out & EP In address, EP size
-  TUD_MSC_DESCRIPTOR(ITF_NUM_MSC, 5, EPNUM_MSC, 0x80 | EPNUM_MSC, (CFG_TUSB_RHPORT0_MODE & OPT_MODE_HIGH_SPEED) ? 512 : 64),
+  #define DESC_MSC(_epsize)  TUD_MSC_DESCRIPTOR(ITF_NUM_MSC, 5, EPNUM_MSC, 0x80 | EPNUM_MSC, _epsize),
+#else
+  #define DESC_MSC(_epsize)
 #endif
 
 #if CFG_TUD_HID
   // Interface number, string index, protocol, report descriptor len, EP In address, size & polling interval
-  TUD_HID_DESCRIPTOR(ITF_NUM_HID, 6, HID_PROTOCOL_NONE, sizeof(desc_hid_report), 0x84, 16, 10)
+  #define DESC_HID(_interval)  TUD_HID_DESCRIPTOR(ITF_NUM_HID, 6, HID_PROTOCOL_NONE, sizeof(desc_hid_report), 0x84, 16, _interval),
+#else
+  #define DESC_HID(_interval)
 #endif
+
+// Bulk endpoint is 64 bytes, HID is polled every 10 ms (interval in frames)
+uint8_t const desc_fs_configuration[] =
+{
+  DESC_CONFIGURATION(64, 10)
+};
+
+#if CFG_TUSB_RHPORT0_MODE & OPT_MODE_HIGH_SPEED
+// Bulk endpoint must be 512 bytes at high speed. HID interval is 2^(bInterval-1) microframes:
+// 7 is 64 microframes = 8 ms, the closest to full speed's 10 ms.
+uint8_t const desc_hs_configuration[] =
+{
+  DESC_CONFIGURATION(512, 7)
+};
+
+// Device descriptor when running at the other speed
+tusb_desc_device_qualifier_t const desc_device_qualifier =
+{
+  .bLength            = sizeof(tusb_desc_device_qualifier_t),
+  .bDescriptorType    = TUSB_DESC_DEVICE_QUALIFIER,
+  .bcdUSB             = 0x0200,
+
+#if CFG_TUD_CDC
+  .bDeviceClass       = TUSB_CLASS_MISC,
+  .bDeviceSubClass    = MISC_SUBCLASS_COMMON,
+  .bDeviceProtocol    = MISC_PROTOCOL_IAD,
+#else
+  .bDeviceClass       = 0x00,
+  .bDeviceSubClass    = 0x00,
+  .bDeviceProtocol    = 0x00,
+#endif
+
+  .bMaxPacketSize0    = CFG_TUD_ENDOINT0_SIZE,
+  .bNumConfigurations = 0x01,
+  .bReserved          = 0x00
 };
 
+// Configuration of the other speed, built from the one above with its type changed
+static uint8_t desc_other_speed_configuration[CONFIG_TOTAL_LEN];
+#endif
+
 // Invoked when received GET DEVICE DESCRIPTOR
 // Application return pointer to descriptor
 uint8_t const * tud_descriptor_device_cb(void)
@@ -158,8 +206,36 @@ uint8_t const * tud_descriptor_device_cb(void)
 uint8_t const * tud_descriptor_configuration_cb(uint8_t index)
 {
   (void) index; // for multiple configurations
-  return desc_configuration;
+
+#if CFG_TUSB_RHPORT0_MODE & OPT_MODE_HIGH_SPEED
+  if ( tud_speed_get() == TUSB_SPEED_HIGH ) return desc_hs_configuration;
+#endif
+
+  return desc_fs_configuration;
 }
+
+#if CFG_TUSB_RHPORT0_MODE & OPT_MODE_HIGH_SPEED
+// Invoked when received GET DEVICE QUALIFIER DESCRIPTOR request
+// Application return pointer to descriptor, only needed by high speed capable device
+uint8_t const * tud_descriptor_device_qualifier_cb(void)
+{
+  return (uint8_t const *) &desc_device_qualifier;
+}
+
+// Invoked when received GET OTHER SPEED CONFIGURATION DESCRIPTOR request
+// Application return pointer to descriptor, whose contents must exist long enough for transfer to complete
+uint8_t const * tud_descriptor_other_speed_configuration_cb(uint8_t index)
+{
+  (void) index; // for multiple configurations
+
+  uint8_t const* desc = (tud_speed_get() == TUSB_SPEED_HIGH) ? desc_fs_configuration : desc_hs_configuration;
+
+  memcpy(desc_other_speed_configuration, desc, CONFIG_TOTAL_LEN);
+  desc_other_speed_configuration[1] = TUSB_DESC_OTHER_SPEED_CONFIG;
+
+  return desc_other_speed_configuration;
+}
+#endif
 //------------- String Descriptors -------------//
 
 // array of pointer to string descriptors
@@ -83,6 +83,9 @@
 // Should be sufficient to hold ID (if any) + Data
 #define CFG_TUD_HID_BUFSIZE         64
 
+// Echo output report from usb isr, tud_hid_set_report_cb() only queues the reply
+#define CFG_TUD_HID_EP_OUT_ISR      1
+
 #ifdef __cplusplus
  }
 #endif
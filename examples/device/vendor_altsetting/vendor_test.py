@@ -0,0 +1,31 @@
+# Install python3 pyusb package https://pypi.org/project/pyusb/
+import usb.core
+import usb.util
+
+USB_VID = 0xcafe
+
+print("Openning Vendor device with VID = 0x%X" % USB_VID)
+
+dev = usb.core.find(idVendor=USB_VID)
+if dev is None:
+    raise ValueError("Device not found")
+
+dev.set_configuration()
+cfg = dev.get_active_configuration()
+
+# Default setting is zero bandwidth
+itf = cfg[(0, 0)]
+assert itf.bNumEndpoints == 0, "alternate setting 0 must not have endpoint"
+
+# Select alternate setting 1 to get bulk endpoints
+dev.set_interface_altsetting(interface=0, alternate_setting=1)
+itf = cfg[(0, 1)]
+ep_out = usb.util.find_descriptor(itf, custom_match=lambda e: usb.util.endpoint_direction(e.bEndpointAddress) == usb.util.ENDPOINT_OUT)
+ep_in  = usb.util.find_descriptor(itf, custom_match=lambda e: usb.util.endpoint_direction(e.bEndpointAddress) == usb.util.ENDPOINT_IN)
+
+while True:
+    # Get input from console and encode to UTF8 for array of chars.
+    str_out = input("Send text to Vendor Device : ").encode('utf-8')
+    ep_out.write(str_out)
+    str_in = ep_in.read(64)
+    print("Received from Vendor Device:", bytes(str_in), '\n')
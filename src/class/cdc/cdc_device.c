@@ -36,6 +36,7 @@
 //--------------------------------------------------------------------+
 typedef struct
 {
+  uint8_t rhport;
   uint8_t itf_num;
   uint8_t ep_notif;
   uint8_t ep_in;
@@ -44,6 +45,24 @@ typedef struct
   // Bit 0:  DTR (Data Terminal Ready), Bit 1: RTS (Request to Send)
   uint8_t line_state;
 
+  // OUT transfers use two buffers in turn, so that host is not NAKed while one is copied to fifo
+  uint8_t rx_armed; // number of buffers submitted to OUT endpoint, only updated by usbd task
+  uint8_t rx_idx;   // buffer of the next OUT transfer to complete
+  volatile bool rx_deferred; // re-arming OUT endpoint is queued to usbd task
+
+#if CFG_TUD_CDC_TX_FLUSH_MS
+  uint16_t tx_flush_frames; // SOFs left before partial packet is flushed, 0 if not armed
+#endif
+
+  // Transfers are only started by usbd task, application defers its requests there
+  volatile bool tx_deferred;  // tx work is queued to usbd task
+  volatile bool tx_flush_req; // application asked for flush
+
+#if TUD_OPT_DCD_DMA_ANY_BUFFER
+  // number of bytes being sent or queued directly from tx fifo
+  uint16_t tx_inflight;
+#endif
+
   /*------------- From this point, data is not cleared by bus reset -------------*/
   char    wanted_char;
   cdc_line_coding_t line_coding;
@@ -55,14 +74,25 @@ typedef struct
   uint8_t rx_ff_buf[CFG_TUD_CDC_RX_BUFSIZE];
   uint8_t tx_ff_buf[CFG_TUD_CDC_TX_BUFSIZE];
 
-#if CFG_FIFO_MUTEX
+#if CFG_FIFO_MUTEX && !CFG_FIFO_SPSC
   osal_mutex_def_t rx_ff_mutex;
   osal_mutex_def_t tx_ff_mutex;
 #endif
 
+#if CFG_TUSB_OS != OPT_OS_NONE
+  // signaled when data is received / IN transfer is complete, for blocking read & write
+  osal_semaphore_def_t rx_sem_def;
+  osal_semaphore_def_t tx_sem_def;
+
+  osal_semaphore_t rx_sem;
+  osal_semaphore_t tx_sem;
+#endif
+
   // Endpoint Transfer buffer
-  CFG_TUSB_MEM_ALIGN uint8_t epout_buf[CFG_TUD_CDC_EPSIZE];
+  CFG_TUSB_MEM_ALIGN uint8_t epout_buf[2][CFG_TUD_CDC_EPSIZE];
+#if !TUD_OPT_DCD_DMA_ANY_BUFFER
   CFG_TUSB_MEM_ALIGN uint8_t epin_buf[CFG_TUD_CDC_EPSIZE];
+#endif
 
 }cdcd_interface_t;
 
@@ -73,23 +103,73 @@ typedef struct
 //--------------------------------------------------------------------+
 CFG_TUSB_MEM_SECTION static cdcd_interface_t _cdcd_itf[CFG_TUD_CDC];
 
-// TODO will be replaced by dcd_edpt_busy()
-bool pending_read_from_host;
+// Map endpoint and interface number of each roothub port to CDC instance ( 0xff is invalid )
+static uint8_t _cdcd_ep2itf    [TUD_OPT_RHPORT_COUNT][8][2];
+static uint8_t _cdcd_itfnum2itf[TUD_OPT_RHPORT_COUNT][16];
+
+static inline uint8_t get_itf_by_ep(uint8_t rhport, uint8_t ep_addr)
+{
+  return _cdcd_ep2itf[usbd_rhport_idx(rhport)][tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+}
+
+static inline uint8_t get_itf_by_itfnum(uint8_t rhport, uint8_t itf_num)
+{
+  return (itf_num < 16) ? _cdcd_itfnum2itf[usbd_rhport_idx(rhport)][itf_num] : 0xff;
+}
+
+static inline void map_ep(uint8_t rhport, uint8_t ep_addr, uint8_t itf)
+{
+  if ( ep_addr ) _cdcd_ep2itf[usbd_rhport_idx(rhport)][tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)] = itf;
+}
+
+static bool _tx_defer (uint8_t itf, bool flush);
+static bool _write_flush (uint8_t itf);
+
 static void _prep_out_transaction (uint8_t itf)
 {
   cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
 
-  // skip if previous transfer not complete
-  // dcd_edpt_busy() doesn't work, probably transfer is complete but not properly handled by the stack
-//  if ( dcd_edpt_busy(TUD_OPT_RHPORT, p_cdc->ep_out) ) return;
-  if (pending_read_from_host) return;
+  // Prepare for incoming data but only allow what we can store in the ring buffer,
+  // including data of buffers already submitted. Second one is queued by usbd and started as soon as
+  // the first is complete.
+  uint16_t const max_read = tu_fifo_remaining(&p_cdc->rx_ff);
+
+  while ( (p_cdc->rx_armed < 2) && (max_read >= (p_cdc->rx_armed + 1)*CFG_TUD_CDC_EPSIZE) )
+  {
+    uint8_t* buf = p_cdc->epout_buf[(p_cdc->rx_idx + p_cdc->rx_armed) & 1];
+    if ( !usbd_edpt_xfer(p_cdc->rhport, p_cdc->ep_out, buf, CFG_TUD_CDC_EPSIZE) ) break;
+
+    p_cdc->rx_armed++;
+  }
+}
+
+// Re-arm OUT endpoint in usbd task after application freed space in rx fifo
+static void _rx_task (void* param)
+{
+  uint8_t const itf = (uint8_t) (uintptr_t) param;
+  cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
+
+  p_cdc->rx_deferred = false;
 
-  // Prepare for incoming data but only allow what we can store in the ring buffer.
-  uint16_t max_read = tu_fifo_remaining(&p_cdc->rx_ff);
-  if ( max_read >= CFG_TUD_CDC_EPSIZE )
+  // interface could be closed by bus reset since deferral
+  if ( p_cdc->ep_out ) _prep_out_transaction(itf);
+}
+
+static void _rx_defer (uint8_t itf)
+{
+  cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
+
+  // nothing to do if both buffers are armed, OUT complete re-arms them by itself
+  if ( !p_cdc->rx_deferred && (p_cdc->rx_armed < 2) )
   {
-    dcd_edpt_xfer(TUD_OPT_RHPORT, p_cdc->ep_out, p_cdc->epout_buf, CFG_TUD_CDC_EPSIZE);
-    pending_read_from_host = true;
+    p_cdc->rx_deferred = true;
+
+    if ( !usbd_defer_func(_rx_task, (void*) (uintptr_t) itf, false) )
+    {
+      // event queue is full, arm right away rather than leaving OUT endpoint idle
+      p_cdc->rx_deferred = false;
+      _prep_out_transaction(itf);
+    }
   }
 }
 
@@ -99,7 +179,7 @@ static void _prep_out_transaction (uint8_t itf)
 bool tud_cdc_n_connected(uint8_t itf)
 {
   // DTR (bit 0) active  is considered as connected
-  return tud_ready() && tu_bit_test(_cdcd_itf[itf].line_state, 0);
+  return tud_n_ready(_cdcd_itf[itf].rhport) && tu_bit_test(_cdcd_itf[itf].line_state, 0);
 }
 
 uint8_t tud_cdc_n_get_line_state (uint8_t itf)
@@ -135,7 +215,7 @@ signed char tud_cdc_n_read_char(uint8_t itf)
 uint32_t tud_cdc_n_read(uint8_t itf, void* buffer, uint32_t bufsize)
 {
   uint32_t num_read = tu_fifo_read_n(&_cdcd_itf[itf].rx_ff, buffer, bufsize);
-  _prep_out_transaction(itf);
+  _rx_defer(itf);
   return num_read;
 }
 
@@ -145,11 +225,50 @@ signed char tud_cdc_n_peek(uint8_t itf, int pos)
   return tu_fifo_peek_at(&_cdcd_itf[itf].rx_ff, pos, &ch) ? ch : (-1);
 }
 
+uint32_t tud_cdc_n_peek_n(uint8_t itf, void* buffer, uint32_t bufsize)
+{
+  return tu_fifo_peek_n(&_cdcd_itf[itf].rx_ff, buffer, (uint16_t) tu_min32(bufsize, UINT16_MAX));
+}
+
+int32_t tud_cdc_n_find(uint8_t itf, char ch)
+{
+  uint16_t pos;
+  return tu_fifo_find(&_cdcd_itf[itf].rx_ff, (uint8_t) ch, &pos) ? pos : (-1);
+}
+
 void tud_cdc_n_read_flush (uint8_t itf)
 {
   tu_fifo_clear(&_cdcd_itf[itf].rx_ff);
-  _prep_out_transaction(itf);
+  _rx_defer(itf);
+}
+
+#if CFG_TUSB_OS != OPT_OS_NONE
+uint32_t tud_cdc_n_read_timeout(uint8_t itf, void* buffer, uint32_t bufsize, uint32_t timeout_ms)
+{
+  cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
+  uint32_t const start_ms = osal_time_millis();
+
+  // Semaphore is cleared before checking fifo, so that data received after the check is not missed
+  while(1)
+  {
+    osal_semaphore_reset(p_cdc->rx_sem);
+    if ( tu_fifo_count(&p_cdc->rx_ff) ) break;
+
+    // Semaphore may be posted without readable data (e.g consumed by another reader), only wait for what is left
+    uint32_t wait_ms = timeout_ms;
+    if ( timeout_ms != OSAL_TIMEOUT_WAIT_FOREVER )
+    {
+      uint32_t const elapsed_ms = osal_time_millis() - start_ms;
+      if ( elapsed_ms >= timeout_ms ) return 0;
+      wait_ms = timeout_ms - elapsed_ms;
+    }
+
+    if ( !osal_semaphore_wait(p_cdc->rx_sem, wait_ms) ) return 0;
+  }
+
+  return tud_cdc_n_read(itf, buffer, bufsize);
 }
+#endif
 
 //--------------------------------------------------------------------+
 // WRITE API
@@ -167,34 +286,163 @@ uint32_t tud_cdc_n_write_str (uint8_t itf, char const* str)
 
 uint32_t tud_cdc_n_write(uint8_t itf, void const* buffer, uint32_t bufsize)
 {
-  uint16_t ret = tu_fifo_write_n(&_cdcd_itf[itf].tx_ff, buffer, bufsize);
+  cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
+  uint16_t ret = tu_fifo_write_n(&p_cdc->tx_ff, buffer, bufsize);
+
+#if CFG_TUD_CDC_TX_AUTOFLUSH
+  // flush if queue more than endpoint size, the rest is sent when IN transfer is complete
+  bool const flush = (tu_fifo_count(&p_cdc->tx_ff) >= CFG_TUD_CDC_EPSIZE);
+#else
+  bool const flush = false;
+#endif
+
+  // with flush deadline, usbd task also arms it for partial packet
+  if ( ret && (flush || CFG_TUD_CDC_TX_FLUSH_MS) )
+  {
+    // event queue is full: flush right away, partial packet waits for next write
+    if ( !_tx_defer(itf, flush) && flush ) _write_flush(itf);
+  }
+
+  return ret;
+}
+
+#if CFG_TUSB_OS != OPT_OS_NONE
+uint32_t tud_cdc_n_write_timeout(uint8_t itf, void const* buffer, uint32_t bufsize, uint32_t timeout_ms)
+{
+  cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
+  uint8_t const* buf8 = (uint8_t const*) buffer;
+  uint32_t total = 0;
 
-#if 0 // TODO issue with circuitpython's REPL
-  // flush if queue more than endpoint size
-  if ( tu_fifo_count(&_cdcd_itf[itf].tx_ff) >= CFG_TUD_CDC_EPSIZE )
+  while(1)
   {
+    osal_semaphore_reset(p_cdc->tx_sem);
+
+    total += tud_cdc_n_write(itf, buf8 + total, tu_min32(bufsize - total, UINT16_MAX));
+    if ( (total == bufsize) || !tud_cdc_n_connected(itf) ) break;
+
+    // fifo is full, make room by sending it then wait for IN transfer to complete
     tud_cdc_n_write_flush(itf);
+    if ( !osal_semaphore_wait(p_cdc->tx_sem, timeout_ms) ) break;
   }
-#endif
 
-  return ret;
+  return total;
 }
+#endif
 
-bool tud_cdc_n_write_flush (uint8_t itf)
+// Start IN transfer with data in tx fifo, only called by usbd task
+static bool _write_flush (uint8_t itf)
 {
   cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
-  TU_VERIFY( !dcd_edpt_busy(TUD_OPT_RHPORT, p_cdc->ep_in) ); // skip if previous transfer not complete
+
+#if TUD_OPT_DCD_DMA_ANY_BUFFER
+  // Send directly from fifo memory, data is removed from fifo when transfer is complete.
+  // Data not yet in flight is queued packet by packet on the endpoint until its queue is full,
+  // so that they are sent back-to-back.
+  tu_fifo_buffer_info_t info;
+  tu_fifo_get_read_info(&p_cdc->tx_ff, &info);
+
+  uint16_t const total = info.len_lin + info.len_wrap;
+  if ( p_cdc->tx_inflight >= total ) return true; // nothing new to send
+
+  if ( !tud_cdc_n_connected(itf) )
+  {
+    // discard data if not connected
+    if ( !p_cdc->tx_inflight ) tu_fifo_advance_read_pointer(&p_cdc->tx_ff, total);
+    return false;
+  }
+
+  while ( p_cdc->tx_inflight < total )
+  {
+    uint8_t* ptr;
+    uint16_t count;
+
+    if ( p_cdc->tx_inflight < info.len_lin )
+    {
+      ptr   = ((uint8_t*) info.ptr_lin) + p_cdc->tx_inflight;
+      count = info.len_lin - p_cdc->tx_inflight;
+    }else
+    {
+      uint16_t const offset = p_cdc->tx_inflight - info.len_lin;
+      ptr   = ((uint8_t*) info.ptr_wrap) + offset;
+      count = info.len_wrap - offset;
+    }
+    count = tu_min16(count, CFG_TUD_CDC_EPSIZE);
+
+    // stop if endpoint queue is full, the rest is sent by next flush
+    if ( !usbd_edpt_xfer(p_cdc->rhport, p_cdc->ep_in, ptr, count) ) break;
+    p_cdc->tx_inflight += count;
+  }
+#else
+  TU_VERIFY( !usbd_edpt_busy(p_cdc->rhport, p_cdc->ep_in) ); // skip if previous transfer not complete
 
   uint16_t count = tu_fifo_read_n(&_cdcd_itf[itf].tx_ff, p_cdc->epin_buf, CFG_TUD_CDC_EPSIZE);
   if ( count )
   {
     TU_VERIFY( tud_cdc_n_connected(itf) ); // fifo is empty if not connected
-    TU_ASSERT( dcd_edpt_xfer(TUD_OPT_RHPORT, p_cdc->ep_in, p_cdc->epin_buf, count) );
+    TU_ASSERT( usbd_edpt_xfer(p_cdc->rhport, p_cdc->ep_in, p_cdc->epin_buf, count) );
   }
+#endif
 
   return true;
 }
 
+// Carry out deferred tx work of application in usbd task
+static void _tx_task (void* param)
+{
+  uint8_t const itf = (uint8_t) (uintptr_t) param;
+  cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
+
+  // clear flags before looking at fifo, data written after that is handled by next deferral
+  p_cdc->tx_deferred = false;
+
+  if ( p_cdc->tx_flush_req )
+  {
+    p_cdc->tx_flush_req = false;
+    _write_flush(itf);
+  }
+
+#if CFG_TUD_CDC_TX_FLUSH_MS
+  // start waiting for more data, partial packet is flushed by SOF when time is up
+  if ( !p_cdc->tx_flush_frames && !tu_fifo_empty(&p_cdc->tx_ff) && tud_cdc_n_connected(itf) )
+  {
+    // high speed SOF is sent every micro-frame
+    uint16_t const sof_per_ms = (tud_n_speed_get(p_cdc->rhport) == TUSB_SPEED_HIGH) ? 8 : 1;
+
+    p_cdc->tx_flush_frames = (uint16_t) (CFG_TUD_CDC_TX_FLUSH_MS*sof_per_ms);
+    usbd_sof_enable(p_cdc->rhport, TUSB_CLASS_CDC, true);
+  }
+#endif
+}
+
+// Queue tx work to usbd task, at most one is queued per interface.
+// Return false if event queue is full, caller has to do the work itself.
+static bool _tx_defer (uint8_t itf, bool flush)
+{
+  cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
+
+  if ( flush ) p_cdc->tx_flush_req = true;
+
+  if ( p_cdc->tx_deferred ) return true;
+
+  p_cdc->tx_deferred = true;
+  if ( usbd_defer_func(_tx_task, (void*) (uintptr_t) itf, false) ) return true;
+
+  // nothing is queued, flags must not stay set or no further request would be queued
+  p_cdc->tx_deferred  = false;
+  p_cdc->tx_flush_req = false;
+
+  return false;
+}
+
+bool tud_cdc_n_write_flush (uint8_t itf)
+{
+  // event queue is full, flush right away
+  if ( !_tx_defer(itf, true) ) return _write_flush(itf);
+
+  // data is discarded by usbd task if not connected
+  return tud_cdc_n_connected(itf);
+}
+
 
 //--------------------------------------------------------------------+
 // USBD Driver API
@@ -203,6 +451,9 @@ void cdcd_init(void)
 {
   tu_memclr(_cdcd_itf, sizeof(_cdcd_itf));
 
+  memset(_cdcd_ep2itf    , 0xff, sizeof(_cdcd_ep2itf));
+  memset(_cdcd_itfnum2itf, 0xff, sizeof(_cdcd_itfnum2itf));
+
   for(uint8_t i=0; i<CFG_TUD_CDC; i++)
   {
     cdcd_interface_t* p_cdc = &_cdcd_itf[i];
@@ -219,19 +470,28 @@ void cdcd_init(void)
     tu_fifo_config(&p_cdc->rx_ff, p_cdc->rx_ff_buf, CFG_TUD_CDC_RX_BUFSIZE, 1, false);
     tu_fifo_config(&p_cdc->tx_ff, p_cdc->tx_ff_buf, CFG_TUD_CDC_TX_BUFSIZE, 1, false);
 
-#if CFG_FIFO_MUTEX
+#if CFG_FIFO_MUTEX && !CFG_FIFO_SPSC
     tu_fifo_config_mutex(&p_cdc->rx_ff, osal_mutex_create(&p_cdc->rx_ff_mutex));
     tu_fifo_config_mutex(&p_cdc->tx_ff, osal_mutex_create(&p_cdc->tx_ff_mutex));
 #endif
+
+#if CFG_TUSB_OS != OPT_OS_NONE
+    p_cdc->rx_sem = osal_semaphore_create(&p_cdc->rx_sem_def);
+    p_cdc->tx_sem = osal_semaphore_create(&p_cdc->tx_sem_def);
+#endif
   }
 }
 
 void cdcd_reset(uint8_t rhport)
 {
-  (void) rhport;
+  memset(_cdcd_ep2itf    [usbd_rhport_idx(rhport)], 0xff, sizeof(_cdcd_ep2itf[0]));
+  memset(_cdcd_itfnum2itf[usbd_rhport_idx(rhport)], 0xff, sizeof(_cdcd_itfnum2itf[0]));
 
   for(uint8_t i=0; i<CFG_TUD_CDC; i++)
   {
+    // skip interfaces opened on other roothub port
+    if ( _cdcd_itf[i].rhport != rhport ) continue;
+
     tu_memclr(&_cdcd_itf[i], ITF_MEM_RESET_SIZE);
     tu_fifo_clear(&_cdcd_itf[i].rx_ff);
     tu_fifo_clear(&_cdcd_itf[i].tx_ff);
@@ -259,10 +519,14 @@ bool cdcd_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint16_t
     }
   }
   TU_ASSERT(p_cdc);
+  TU_ASSERT(itf_desc->bInterfaceNumber < 16);
 
   //------------- Control Interface -------------//
+  p_cdc->rhport  = rhport;
   p_cdc->itf_num = itf_desc->bInterfaceNumber;
 
+  _cdcd_itfnum2itf[usbd_rhport_idx(rhport)][p_cdc->itf_num] = cdc_id;
+
   uint8_t const * p_desc = tu_desc_next( itf_desc );
   (*p_length) = sizeof(tusb_desc_interface_t);
 
@@ -288,6 +552,10 @@ bool cdcd_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint16_t
   if ( (TUSB_DESC_INTERFACE == p_desc[DESC_OFFSET_TYPE]) &&
        (TUSB_CLASS_CDC_DATA == ((tusb_desc_interface_t const *) p_desc)->bInterfaceClass) )
   {
+    // class request could also be addressed to data interface
+    uint8_t const data_itf_num = ((tusb_desc_interface_t const *) p_desc)->bInterfaceNumber;
+    if ( data_itf_num < 16 ) _cdcd_itfnum2itf[usbd_rhport_idx(rhport)][data_itf_num] = cdc_id;
+
     // next to endpoint descriptor
     p_desc = tu_desc_next(p_desc);
 
@@ -297,24 +565,56 @@ bool cdcd_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint16_t
     (*p_length) += sizeof(tusb_desc_interface_t) + 2*sizeof(tusb_desc_endpoint_t);
   }
 
+  map_ep(rhport, p_cdc->ep_notif, cdc_id);
+  map_ep(rhport, p_cdc->ep_out  , cdc_id);
+  map_ep(rhport, p_cdc->ep_in   , cdc_id);
+
   // Prepare for incoming data
-  pending_read_from_host = false;
+  p_cdc->rx_armed = 0;
+  p_cdc->rx_idx   = 0;
   _prep_out_transaction(cdc_id);
 
   return true;
 }
 
+// Count down partial packet flush deadline of interfaces on this port, SOF is only subscribed
+// while there is one armed.
+void cdcd_sof(uint8_t rhport)
+{
+#if CFG_TUD_CDC_TX_FLUSH_MS
+  bool armed = false;
+
+  for(uint8_t i=0; i<CFG_TUD_CDC; i++)
+  {
+    cdcd_interface_t* p_cdc = &_cdcd_itf[i];
+    if ( (p_cdc->rhport != rhport) || !p_cdc->tx_flush_frames ) continue;
+
+    if ( 0 == --p_cdc->tx_flush_frames )
+    {
+      _write_flush(i);
+
+      // retry next frame if not everything is sent e.g endpoint is still busy
+      if ( !tu_fifo_empty(&p_cdc->tx_ff) && tud_cdc_n_connected(i) ) p_cdc->tx_flush_frames = 1;
+    }
+
+    if ( p_cdc->tx_flush_frames ) armed = true;
+  }
+
+  if ( !armed ) usbd_sof_enable(rhport, TUSB_CLASS_CDC, false);
+#else
+  (void) rhport;
+#endif
+}
+
 // Invoked when class request DATA stage is finished.
 // return false to stall control endpoint (e.g Host send non-sense DATA)
 bool cdcd_control_request_complete(uint8_t rhport, tusb_control_request_t const * request)
 {
-  (void) rhport;
-
   //------------- Class Specific Request -------------//
   TU_VERIFY (request->bmRequestType_bit.type == TUSB_REQ_TYPE_CLASS);
 
-  // TODO Support multiple interfaces
-  uint8_t const itf = 0;
+  uint8_t const itf = get_itf_by_itfnum(rhport, tu_u16_low(request->wIndex));
+  TU_VERIFY(itf < CFG_TUD_CDC);
   cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
 
   // Invoke callback
@@ -333,8 +633,8 @@ bool cdcd_control_request(uint8_t rhport, tusb_control_request_t const * request
   //------------- Class Specific Request -------------//
   TU_ASSERT(request->bmRequestType_bit.type == TUSB_REQ_TYPE_CLASS);
 
-  // TODO Support multiple interfaces
-  uint8_t const itf = 0;
+  uint8_t const itf = get_itf_by_itfnum(rhport, tu_u16_low(request->wIndex));
+  TU_VERIFY(itf < CFG_TUD_CDC);
   cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
 
   switch ( request->bRequest )
@@ -369,36 +669,79 @@ bool cdcd_control_request(uint8_t rhport, tusb_control_request_t const * request
 
 bool cdcd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes)
 {
-  (void) rhport;
   (void) result;
 
-  // TODO Support multiple interfaces
-  uint8_t const itf = 0;
+  uint8_t const itf = get_itf_by_ep(rhport, ep_addr);
+  TU_VERIFY(itf < CFG_TUD_CDC);
   cdcd_interface_t* p_cdc = &_cdcd_itf[itf];
 
   // receive new data
   if ( ep_addr == p_cdc->ep_out )
   {
-    for(uint32_t i=0; i<xferred_bytes; i++)
+    uint8_t const* epout_buf = p_cdc->epout_buf[p_cdc->rx_idx];
+    uint16_t const count = (uint16_t) xferred_bytes;
+
+    // space for the whole packet is reserved before the transfer is submitted
+    tu_fifo_write_n(&p_cdc->rx_ff, epout_buf, count);
+
+    // Check for wanted char and invoke callback for each occurrence, whole packet is already in fifo
+    if ( tud_cdc_rx_wanted_cb && ( ((signed char) p_cdc->wanted_char) != -1 ) )
     {
-      tu_fifo_write(&p_cdc->rx_ff, &p_cdc->epout_buf[i]);
+      uint8_t const* p_end = epout_buf + count;
+      uint8_t const* p_ch  = epout_buf;
 
-      // Check for wanted char and invoke callback if needed
-      if ( tud_cdc_rx_wanted_cb && ( ((signed char) p_cdc->wanted_char) != -1 ) && ( p_cdc->wanted_char == p_cdc->epout_buf[i] ) )
+      while ( (p_ch < p_end) && (NULL != (p_ch = memchr(p_ch, (uint8_t) p_cdc->wanted_char, (size_t) (p_end - p_ch)))) )
       {
         tud_cdc_rx_wanted_cb(itf, p_cdc->wanted_char);
+        p_ch++;
       }
     }
 
+    // buffer is free to be submitted again
+    p_cdc->rx_idx ^= 1;
+    p_cdc->rx_armed--;
+
+#if CFG_TUSB_OS != OPT_OS_NONE
+    if ( count ) osal_semaphore_post(p_cdc->rx_sem, false);
+#endif
+
     // invoke receive callback (if there is still data)
     if (tud_cdc_rx_cb && tu_fifo_count(&p_cdc->rx_ff) ) tud_cdc_rx_cb(itf);
 
     // prepare for OUT transaction
-    pending_read_from_host = false;
     _prep_out_transaction(itf);
   }
 
-  // nothing to do with in and notif endpoint for now
+  if ( ep_addr == p_cdc->ep_in )
+  {
+#if TUD_OPT_DCD_DMA_ANY_BUFFER
+    // data sent from fifo memory can now be released
+    uint16_t const count = tu_min16((uint16_t) xferred_bytes, p_cdc->tx_inflight);
+
+    tu_fifo_advance_read_pointer(&p_cdc->tx_ff, count);
+    p_cdc->tx_inflight -= count;
+#endif
+
+#if CFG_TUD_CDC_TX_AUTOFLUSH
+    // keep sending while there is data
+    _write_flush(itf);
+#endif
+
+#if CFG_TUSB_OS != OPT_OS_NONE
+    // wake up writer waiting for fifo space
+    osal_semaphore_post(p_cdc->tx_sem, false);
+#endif
+
+    // Host only completes its bulk transfer with a short packet. If the last packet is full and there is
+    // nothing more to send, terminate the transfer with a zero-length packet.
+    if ( xferred_bytes && (0 == (xferred_bytes % CFG_TUD_CDC_EPSIZE)) &&
+         tu_fifo_empty(&p_cdc->tx_ff) && !usbd_edpt_busy(rhport, p_cdc->ep_in) && tud_cdc_n_connected(itf) )
+    {
+      usbd_edpt_xfer(rhport, p_cdc->ep_in, NULL, 0);
+    }
+  }
+
+  // nothing to do with notif endpoint for now
 
   return true;
 }
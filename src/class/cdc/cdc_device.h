@@ -38,6 +38,18 @@
 #define CFG_TUD_CDC_EPSIZE 64
 #endif
 
+// Send TX data without waiting for tud_cdc_n_write_flush(): a packet is sent as soon as it is full,
+// and following packets are sent from IN transfer complete while there is data in the fifo.
+#ifndef CFG_TUD_CDC_TX_AUTOFLUSH
+#define CFG_TUD_CDC_TX_AUTOFLUSH 0
+#endif
+
+// Send a partial packet once it waits this long (ms) for more data, 0 to only send it with
+// tud_cdc_n_write_flush(). Counted with SOF, port that never generates SOF event won't send it.
+#ifndef CFG_TUD_CDC_TX_FLUSH_MS
+#define CFG_TUD_CDC_TX_FLUSH_MS 0
+#endif
+
 #ifdef __cplusplus
  extern "C" {
 #endif
@@ -61,12 +73,26 @@ signed char tud_cdc_n_read_char       (uint8_t itf);
 uint32_t    tud_cdc_n_read            (uint8_t itf, void* buffer, uint32_t bufsize);
 void        tud_cdc_n_read_flush      (uint8_t itf);
 signed char tud_cdc_n_peek            (uint8_t itf, int pos);
+uint32_t    tud_cdc_n_peek_n          (uint8_t itf, void* buffer, uint32_t bufsize);
+int32_t     tud_cdc_n_find            (uint8_t itf, char ch);
 
 uint32_t    tud_cdc_n_write_char      (uint8_t itf, char ch);
 uint32_t    tud_cdc_n_write           (uint8_t itf, void const* buffer, uint32_t bufsize);
 uint32_t    tud_cdc_n_write_str       (uint8_t itf, char const* str);
+
+// Transfer is started by usbd task on its next run (right away if its event queue is full).
+// Return false if not connected. A busy endpoint is not an error: pending data is sent once it is free.
 bool        tud_cdc_n_write_flush     (uint8_t itf);
 
+#if CFG_TUSB_OS != OPT_OS_NONE
+// Wait up to timeout_ms for data to be received, then read what is available. Return 0 on timeout.
+uint32_t    tud_cdc_n_read_timeout    (uint8_t itf, void* buffer, uint32_t bufsize, uint32_t timeout_ms);
+
+// Write all of buffer, waiting for fifo space as needed. Give up when no space is freed within timeout_ms
+// or host is disconnected, return number of bytes written.
+uint32_t    tud_cdc_n_write_timeout   (uint8_t itf, void const* buffer, uint32_t bufsize, uint32_t timeout_ms);
+#endif
+
 //--------------------------------------------------------------------+
 // APPLICATION API (Interface0)
 //--------------------------------------------------------------------+
@@ -80,12 +106,19 @@ static inline signed char tud_cdc_read_char       (void)
 static inline uint32_t    tud_cdc_read            (void* buffer, uint32_t bufsize)       { return tud_cdc_n_read(0, buffer, bufsize);  }
 static inline void        tud_cdc_read_flush      (void)                                 { tud_cdc_n_read_flush(0);                    }
 static inline signed char tud_cdc_peek            (int pos)                              { return tud_cdc_n_peek(0, pos);              }
+static inline uint32_t    tud_cdc_peek_n          (void* buffer, uint32_t bufsize)       { return tud_cdc_n_peek_n(0, buffer, bufsize);}
+static inline int32_t     tud_cdc_find            (char ch)                              { return tud_cdc_n_find(0, ch);               }
 
 static inline uint32_t    tud_cdc_write_char      (char ch)                              { return tud_cdc_n_write_char(0, ch);         }
 static inline uint32_t    tud_cdc_write           (void const* buffer, uint32_t bufsize) { return tud_cdc_n_write(0, buffer, bufsize); }
 static inline uint32_t    tud_cdc_write_str       (char const* str)                      { return tud_cdc_n_write_str(0, str);         }
 static inline bool        tud_cdc_write_flush     (void)                                 { return tud_cdc_n_write_flush(0);            }
 
+#if CFG_TUSB_OS != OPT_OS_NONE
+static inline uint32_t    tud_cdc_read_timeout    (void* buffer, uint32_t bufsize, uint32_t timeout_ms)       { return tud_cdc_n_read_timeout(0, buffer, bufsize, timeout_ms);  }
+static inline uint32_t    tud_cdc_write_timeout   (void const* buffer, uint32_t bufsize, uint32_t timeout_ms) { return tud_cdc_n_write_timeout(0, buffer, bufsize, timeout_ms); }
+#endif
+
 //--------------------------------------------------------------------+
 // APPLICATION CALLBACK API (WEAK is optional)
 //--------------------------------------------------------------------+
@@ -93,7 +126,7 @@ static inline bool        tud_cdc_write_flush     (void)
 // Invoked when received new data
 ATTR_WEAK void tud_cdc_rx_cb(uint8_t itf);
 
-// Invoked when received `wanted_char`
+// Invoked when received `wanted_char`, once for each occurrence after the whole packet is put into fifo
 ATTR_WEAK void tud_cdc_rx_wanted_cb(uint8_t itf, char wanted_char);
 
 // Invoked when line state DTR & RTS are changed via SET_CONTROL_LINE_STATE
@@ -113,6 +146,7 @@ bool cdcd_open               (uint8_t rhport, tusb_desc_interface_t const * p_in
 bool cdcd_control_request (uint8_t rhport, tusb_control_request_t const * p_request);
 bool cdcd_control_request_complete (uint8_t rhport, tusb_control_request_t const * p_request);
 bool cdcd_xfer_cb            (uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
+void cdcd_sof                (uint8_t rhport);
 void cdcd_reset              (uint8_t rhport);
 
 #ifdef __cplusplus
@@ -40,18 +40,63 @@
 /* VARIABLE DECLARATION
  *------------------------------------------------------------------*/
 typedef struct {
+  uint8_t rhport;
   uint8_t itf_num;
+  uint8_t alt;     // current alternate setting
 
-  uint8_t ep_in;
+  uint8_t ep_in;   // 0 if current setting has no endpoint
   uint8_t ep_out;
 
+  CFG_TUSB_MEM_ALIGN uint8_t epout_buf[CFG_TUD_CUSTOM_EPSIZE];
+  CFG_TUSB_MEM_ALIGN uint8_t epin_buf[CFG_TUD_CUSTOM_EPSIZE];
 } cusd_interface_t;
 
-static cusd_interface_t _cusd_itf;
+CFG_TUSB_MEM_SECTION static cusd_interface_t _cusd_itf;
+
+/*------------------------------------------------------------------*/
+/* APPLICATION API
+ *------------------------------------------------------------------*/
+uint8_t tud_custom_alt_get(void)
+{
+  return _cusd_itf.alt;
+}
+
+bool tud_custom_write(void const* buffer, uint16_t len)
+{
+  cusd_interface_t* p_itf = &_cusd_itf;
+
+  // zero bandwidth setting has no endpoint
+  TU_VERIFY(p_itf->ep_in && (len <= CFG_TUD_CUSTOM_EPSIZE));
+  TU_VERIFY(!usbd_edpt_busy(p_itf->rhport, p_itf->ep_in));
+
+  memcpy(p_itf->epin_buf, buffer, len);
+  return usbd_edpt_xfer(p_itf->rhport, p_itf->ep_in, p_itf->epin_buf, len);
+}
 
 /*------------------------------------------------------------------*/
 /* FUNCTION DECLARATION
  *------------------------------------------------------------------*/
+
+// Open endpoints of an alternate setting and prepare for incoming data
+static bool open_endpoints(uint8_t rhport, tusb_desc_interface_t const * desc_itf)
+{
+  cusd_interface_t* p_itf = &_cusd_itf;
+
+  p_itf->ep_in  = 0;
+  p_itf->ep_out = 0;
+
+  if ( desc_itf->bNumEndpoints == 0 ) return true;
+
+  TU_ASSERT( usbd_open_edpt_pair(rhport, tu_desc_next(desc_itf), desc_itf->bNumEndpoints, TUSB_XFER_BULK, &p_itf->ep_out, &p_itf->ep_in) );
+
+  if ( p_itf->ep_out )
+  {
+    TU_ASSERT( usbd_edpt_xfer(rhport, p_itf->ep_out, p_itf->epout_buf, CFG_TUD_CUSTOM_EPSIZE) );
+  }
+
+  return true;
+}
+
 void cusd_init(void)
 {
   tu_varclr(&_cusd_itf);
@@ -61,33 +106,76 @@ bool cusd_open(uint8_t rhport, tusb_desc_interface_t const * p_desc_itf, uint16_
 {
   cusd_interface_t* p_itf = &_cusd_itf;
 
-  // Open endpoint pair with usbd helper
-  tusb_desc_endpoint_t const *p_desc_ep = (tusb_desc_endpoint_t const *) tu_desc_next(p_desc_itf);
-  TU_ASSERT( usbd_open_edpt_pair(rhport, p_desc_ep, TUSB_XFER_BULK, &p_itf->ep_out, &p_itf->ep_in) );
-
+  p_itf->rhport  = rhport;
   p_itf->itf_num = p_desc_itf->bInterfaceNumber;
+  p_itf->alt     = 0;
 
-  (*p_len) = sizeof(tusb_desc_interface_t) + 2*sizeof(tusb_desc_endpoint_t);
+  // Only default setting is opened, the others are selected by host with SET_INTERFACE
+  TU_ASSERT( open_endpoints(rhport, p_desc_itf) );
 
-  // TODO Prepare for incoming data
-//  TU_ASSERT( dcd_edpt_xfer(rhport, p_itf->ep_out, (uint8_t*) &p_msc->cbw, sizeof(msc_cbw_t)) );
+  (*p_len) = (uint16_t) (sizeof(tusb_desc_interface_t) + p_desc_itf->bNumEndpoints*sizeof(tusb_desc_endpoint_t));
+
+  return true;
+}
+
+bool cusd_set_interface(uint8_t rhport, uint8_t itf_num, uint8_t alt)
+{
+  cusd_interface_t* p_itf = &_cusd_itf;
+  TU_VERIFY(itf_num == p_itf->itf_num);
+
+  tusb_desc_interface_t const * desc_itf = usbd_desc_itf_get(rhport, itf_num, alt);
+  TU_VERIFY(desc_itf);
+
+  // Release endpoints of previous setting first, the new one may use the same addresses
+  if ( p_itf->ep_in  ) usbd_edpt_close(rhport, p_itf->ep_in);
+  if ( p_itf->ep_out ) usbd_edpt_close(rhport, p_itf->ep_out);
+
+  TU_ASSERT( open_endpoints(rhport, desc_itf) );
+  p_itf->alt = alt;
+
+  if ( tud_custom_set_interface_cb ) tud_custom_set_interface_cb(alt);
 
   return true;
 }
 
 bool cusd_control_request(uint8_t rhport, tusb_control_request_t const * p_request)
 {
+  (void) rhport;
+  (void) p_request;
+
+  // no class specific request
   return false;
 }
 
+bool cusd_control_request_complete(uint8_t rhport, tusb_control_request_t const * p_request)
+{
+  (void) rhport;
+  (void) p_request;
+
+  return true;
+}
+
 bool cusd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes)
 {
+  (void) event;
+
+  cusd_interface_t* p_itf = &_cusd_itf;
+
+  if ( ep_addr == p_itf->ep_out )
+  {
+    if ( tud_custom_rx_cb ) tud_custom_rx_cb(p_itf->epout_buf, (uint16_t) xferred_bytes);
+
+    // prepare for next OUT transaction
+    TU_ASSERT( usbd_edpt_xfer(rhport, p_itf->ep_out, p_itf->epout_buf, CFG_TUD_CUSTOM_EPSIZE) );
+  }
+
   return true;
 }
 
 void cusd_reset(uint8_t rhport)
 {
-
+  (void) rhport;
+  tu_varclr(&_cusd_itf);
 }
 
 #endif
@@ -31,26 +31,42 @@
 #include "device/usbd.h"
 
 //--------------------------------------------------------------------+
-// APPLICATION API (Multiple Root Ports)
-// Should be used only with MCU that support more than 1 ports
+// Class Driver Configuration
 //--------------------------------------------------------------------+
+#ifndef CFG_TUD_CUSTOM_EPSIZE
+#define CFG_TUD_CUSTOM_EPSIZE     64
+#endif
 
 //--------------------------------------------------------------------+
 // APPLICATION API (Single Port)
 // Should be used with MCU supporting only 1 USB port for code simplicity
 //--------------------------------------------------------------------+
 
+// Alternate setting selected by host, 0 is the default one
+uint8_t tud_custom_alt_get(void);
+
+// Send a packet up to CFG_TUD_CUSTOM_EPSIZE on IN endpoint of current setting, data is copied.
+// Return false if current setting has no endpoint or previous packet is not sent yet.
+// Should be called from usbd task e.g in tud_custom_rx_cb().
+bool tud_custom_write(void const* buffer, uint16_t len);
 
 //--------------------------------------------------------------------+
 // APPLICATION CALLBACK API (WEAK is optional)
 //--------------------------------------------------------------------+
 
+// Invoked when host selects an alternate setting, its endpoints are already opened
+ATTR_WEAK void tud_custom_set_interface_cb(uint8_t alt);
+
+// Invoked when a packet is received on OUT endpoint of current setting
+ATTR_WEAK void tud_custom_rx_cb(uint8_t const* buffer, uint16_t len);
+
 //--------------------------------------------------------------------+
 // Internal Class Driver API
 //--------------------------------------------------------------------+
 void cusd_init(void);
 bool cusd_open(uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint16_t *p_length);
-bool cusd_control_request_st(uint8_t rhport, tusb_control_request_t const * p_request);
+bool cusd_set_interface(uint8_t rhport, uint8_t itf_num, uint8_t alt);
+bool cusd_control_request(uint8_t rhport, tusb_control_request_t const * p_request);
 bool cusd_control_request_complete (uint8_t rhport, tusb_control_request_t const * p_request);
 bool cusd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes);
 void cusd_reset(uint8_t rhport);
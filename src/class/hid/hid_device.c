@@ -40,6 +40,7 @@
 //--------------------------------------------------------------------+
 typedef struct
 {
+  uint8_t rhport;
   uint8_t itf_num;
   uint8_t ep_in;
   uint8_t ep_out;        // optional Out endpoint
@@ -56,11 +57,22 @@ typedef struct
 CFG_TUSB_MEM_SECTION static hidd_interface_t _hidd_itf[CFG_TUD_HID];
 
 /*------------- Helpers -------------*/
-static inline hidd_interface_t* get_interface_by_itfnum(uint8_t itf_num)
+static inline hidd_interface_t* get_interface_by_itfnum(uint8_t rhport, uint8_t itf_num)
 {
   for (uint8_t i=0; i < CFG_TUD_HID; i++ )
   {
-    if ( itf_num == _hidd_itf[i].itf_num ) return &_hidd_itf[i];
+    if ( (rhport == _hidd_itf[i].rhport) && (itf_num == _hidd_itf[i].itf_num) ) return &_hidd_itf[i];
+  }
+
+  return NULL;
+}
+
+static inline hidd_interface_t* get_interface_by_edpt(uint8_t rhport, uint8_t ep_addr)
+{
+  for (uint8_t i=0; i < CFG_TUD_HID; i++ )
+  {
+    hidd_interface_t* p_hid = &_hidd_itf[i];
+    if ( (rhport == p_hid->rhport) && ((ep_addr == p_hid->ep_in) || (ep_addr == p_hid->ep_out)) ) return p_hid;
   }
 
   return NULL;
@@ -72,8 +84,9 @@ static inline hidd_interface_t* get_interface_by_itfnum(uint8_t itf_num)
 bool tud_hid_ready(void)
 {
   uint8_t itf = 0;
+  uint8_t const rhport = _hidd_itf[itf].rhport;
   uint8_t const ep_in = _hidd_itf[itf].ep_in;
-  return tud_ready() && (ep_in != 0) && !dcd_edpt_busy(TUD_OPT_RHPORT, ep_in);
+  return tud_n_ready(rhport) && (ep_in != 0) && !usbd_edpt_busy(rhport, ep_in);
 }
 
 bool tud_hid_report(uint8_t report_id, void const* report, uint8_t len)
@@ -94,7 +107,7 @@ bool tud_hid_report(uint8_t report_id, void const* report, uint8_t len)
     memcpy(p_hid->epin_buf, report, len);
   }
 
-  return dcd_edpt_xfer(TUD_OPT_RHPORT, p_hid->ep_in, p_hid->epin_buf, len);
+  return usbd_edpt_xfer(p_hid->rhport, p_hid->ep_in, p_hid->epin_buf, len);
 }
 
 bool tud_hid_boot_mode(void)
@@ -145,13 +158,16 @@ bool tud_hid_mouse_report(uint8_t report_id, uint8_t buttons, int8_t x, int8_t y
 //--------------------------------------------------------------------+
 void hidd_init(void)
 {
-  hidd_reset(TUD_OPT_RHPORT);
+  tu_memclr(_hidd_itf, sizeof(_hidd_itf));
 }
 
 void hidd_reset(uint8_t rhport)
 {
-  (void) rhport;
-  tu_memclr(_hidd_itf, sizeof(_hidd_itf));
+  for (uint8_t i=0; i < CFG_TUD_HID; i++ )
+  {
+    // skip interfaces opened on other roothub port
+    if ( _hidd_itf[i].rhport == rhport ) tu_varclr(&_hidd_itf[i]);
+  }
 }
 
 bool hidd_open(uint8_t rhport, tusb_desc_interface_t const * desc_itf, uint16_t *p_len)
@@ -171,8 +187,17 @@ bool hidd_open(uint8_t rhport, tusb_desc_interface_t const * desc_itf, uint16_t
   p_desc = tu_desc_next(p_desc);
   TU_ASSERT(usbd_open_edpt_pair(rhport, p_desc, desc_itf->bNumEndpoints, TUSB_XFER_INTERRUPT, &p_hid->ep_out, &p_hid->ep_in));
 
+  // Nothing to do on IN completion, no need to go through usbd task
+  usbd_edpt_isr_dispatch(rhport, p_hid->ep_in, true);
+
+#if CFG_TUD_HID_EP_OUT_ISR
+  // Output report is passed to application and endpoint re-armed right in isr
+  if (p_hid->ep_out) usbd_edpt_isr_dispatch(rhport, p_hid->ep_out, true);
+#endif
+
   if ( desc_itf->bInterfaceSubClass == HID_SUBCLASS_BOOT ) p_hid->boot_protocol = desc_itf->bInterfaceProtocol;
 
+  p_hid->rhport    = rhport;
   p_hid->boot_mode = false; // default mode is REPORT
   p_hid->itf_num   = desc_itf->bInterfaceNumber;
   p_hid->reprot_desc_len  = desc_hid->wReportLength;
@@ -180,7 +205,7 @@ bool hidd_open(uint8_t rhport, tusb_desc_interface_t const * desc_itf, uint16_t
   *p_len = sizeof(tusb_desc_interface_t) + sizeof(tusb_hid_descriptor_hid_t) + desc_itf->bNumEndpoints*sizeof(tusb_desc_endpoint_t);
 
   // Prepare for output endpoint
-  if (p_hid->ep_out) TU_ASSERT(dcd_edpt_xfer(rhport, p_hid->ep_out, p_hid->epout_buf, sizeof(p_hid->epout_buf)));
+  if (p_hid->ep_out) TU_ASSERT(usbd_edpt_xfer(rhport, p_hid->ep_out, p_hid->epout_buf, sizeof(p_hid->epout_buf)));
 
   return true;
 }
@@ -189,7 +214,7 @@ bool hidd_open(uint8_t rhport, tusb_desc_interface_t const * desc_itf, uint16_t
 // return false to stall control endpoint (e.g unsupported request)
 bool hidd_control_request(uint8_t rhport, tusb_control_request_t const * p_request)
 {
-  hidd_interface_t* p_hid = get_interface_by_itfnum( (uint8_t) p_request->wIndex );
+  hidd_interface_t* p_hid = get_interface_by_itfnum(rhport, (uint8_t) p_request->wIndex);
   TU_ASSERT(p_hid);
 
   if (p_request->bmRequestType_bit.type == TUSB_REQ_TYPE_STANDARD)
@@ -222,6 +247,9 @@ bool hidd_control_request(uint8_t rhport, tusb_control_request_t const * p_reque
         uint16_t xferlen  = tud_hid_get_report_cb(report_id, (hid_report_type_t) report_type, p_hid->epin_buf, p_request->wLength);
         TU_ASSERT( xferlen > 0 );
 
+        // application will answer later with tud_control_reply()
+        if ( xferlen == TUD_CONTROL_PENDING ) break;
+
         usbd_control_xfer(rhport, p_request, p_hid->epin_buf, xferlen);
       }
       break;
@@ -275,8 +303,7 @@ bool hidd_control_request(uint8_t rhport, tusb_control_request_t const * p_reque
 // return false to stall control endpoint (e.g Host send non-sense DATA)
 bool hidd_control_request_complete(uint8_t rhport, tusb_control_request_t const * p_request)
 {
-  (void) rhport;
-  hidd_interface_t* p_hid = get_interface_by_itfnum( (uint8_t) p_request->wIndex );
+  hidd_interface_t* p_hid = get_interface_by_itfnum(rhport, (uint8_t) p_request->wIndex);
   TU_ASSERT(p_hid);
 
   if (p_request->bmRequestType_bit.type == TUSB_REQ_TYPE_CLASS &&
@@ -296,14 +323,13 @@ bool hidd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
 {
   (void) result;
 
-  // TODO support multiple HID interface
-  uint8_t const itf = 0;
-  hidd_interface_t * p_hid = &_hidd_itf[itf];
+  hidd_interface_t * p_hid = get_interface_by_edpt(rhport, ep_addr);
+  TU_ASSERT(p_hid);
 
   if (ep_addr == p_hid->ep_out)
   {
     tud_hid_set_report_cb(0, HID_REPORT_TYPE_INVALID, p_hid->epout_buf, xferred_bytes);
-    TU_ASSERT(dcd_edpt_xfer(rhport, p_hid->ep_out, p_hid->epout_buf, sizeof(p_hid->epout_buf)));
+    TU_ASSERT(usbd_edpt_xfer(rhport, p_hid->ep_out, p_hid->epout_buf, sizeof(p_hid->epout_buf)));
   }
 
   return true;
@@ -43,6 +43,12 @@
 #define CFG_TUD_HID_BUFSIZE     16
 #endif
 
+// Invoke tud_hid_set_report_cb() for OUT endpoint data directly in USB isr instead of usbd task,
+// lowering output report latency. The callback must then be isr-safe.
+#ifndef CFG_TUD_HID_EP_OUT_ISR
+#define CFG_TUD_HID_EP_OUT_ISR  0
+#endif
+
 //--------------------------------------------------------------------+
 // Application API
 //--------------------------------------------------------------------+
@@ -75,10 +81,12 @@ uint8_t const * tud_hid_descriptor_report_cb(void);
 // Invoked when received GET_REPORT control request
 // Application must fill buffer report's content and return its length.
 // Return zero will cause the stack to STALL request
+// Return TUD_CONTROL_PENDING to answer later with tud_control_reply() e.g when report is read from a slow sensor,
+// tud_control_token() must be taken before returning
 uint16_t tud_hid_get_report_cb(uint8_t report_id, hid_report_type_t report_type, uint8_t* buffer, uint16_t reqlen);
 
 // Invoked when received SET_REPORT control request or
-// received data on OUT endpoint ( Report ID = 0, Type = 0 )
+// received data on OUT endpoint ( Report ID = 0, Type = 0 ), in isr if CFG_TUD_HID_EP_OUT_ISR is enabled
 void tud_hid_set_report_cb(uint8_t report_id, hid_report_type_t report_type, uint8_t const* buffer, uint16_t bufsize);
 
 // Invoked when received SET_PROTOCOL request ( mode switch Boot <-> Report )
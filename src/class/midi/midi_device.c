@@ -40,6 +40,7 @@
 //--------------------------------------------------------------------+
 typedef struct
 {
+  uint8_t rhport;
   uint8_t itf_num;
   uint8_t ep_in;
   uint8_t ep_out;
@@ -50,7 +51,7 @@ typedef struct
   uint8_t rx_ff_buf[CFG_TUD_MIDI_RX_BUFSIZE];
   uint8_t tx_ff_buf[CFG_TUD_MIDI_TX_BUFSIZE];
 
-  #if CFG_FIFO_MUTEX
+  #if CFG_FIFO_MUTEX && !CFG_FIFO_SPSC
   osal_mutex_def_t rx_ff_mutex;
   osal_mutex_def_t tx_ff_mutex;
   #endif
@@ -133,13 +134,13 @@ void midi_rx_done_cb(midid_interface_t* midi, uint8_t const* buffer, uint32_t bu
 
 static bool maybe_transmit(midid_interface_t* midi, uint8_t itf_index)
 {
-    TU_VERIFY( !dcd_edpt_busy(TUD_OPT_RHPORT, midi->ep_in) ); // skip if previous transfer not complete
+    TU_VERIFY( !usbd_edpt_busy(midi->rhport, midi->ep_in) ); // skip if previous transfer not complete
 
     uint16_t count = tu_fifo_read_n(&midi->tx_ff, midi->epin_buf, CFG_TUD_MIDI_EPSIZE);
     if (count > 0)
     {
       TU_VERIFY( tud_midi_n_connected(itf_index) ); // fifo is empty if not connected
-      TU_ASSERT( dcd_edpt_xfer(TUD_OPT_RHPORT, midi->ep_in, midi->epin_buf, count) );
+      TU_ASSERT( usbd_edpt_xfer(midi->rhport, midi->ep_in, midi->epin_buf, count) );
     }
     return true;
 }
@@ -227,9 +228,11 @@ void midid_init(void)
     midid_interface_t* midi = &_midid_itf[i];
 
     // config fifo
-    tu_fifo_config(&midi->rx_ff, midi->rx_ff_buf, CFG_TUD_MIDI_RX_BUFSIZE, 1, true);
-    tu_fifo_config(&midi->tx_ff, midi->tx_ff_buf, CFG_TUD_MIDI_TX_BUFSIZE, 1, true);
-    #if CFG_FIFO_MUTEX
+    // Overwritable fifo needs a lock since its writer also moves read index. In lock-free mode new data
+    // is dropped instead of old one when fifo is full.
+    tu_fifo_config(&midi->rx_ff, midi->rx_ff_buf, CFG_TUD_MIDI_RX_BUFSIZE, 1, !CFG_FIFO_SPSC);
+    tu_fifo_config(&midi->tx_ff, midi->tx_ff_buf, CFG_TUD_MIDI_TX_BUFSIZE, 1, !CFG_FIFO_SPSC);
+    #if CFG_FIFO_MUTEX && !CFG_FIFO_SPSC
     tu_fifo_config_mutex(&midi->rx_ff, osal_mutex_create(&midi->rx_ff_mutex));
     tu_fifo_config_mutex(&midi->tx_ff, osal_mutex_create(&midi->tx_ff_mutex));
     #endif
@@ -238,11 +241,13 @@ void midid_init(void)
 
 void midid_reset(uint8_t rhport)
 {
-  (void) rhport;
-
   for(uint8_t i=0; i<CFG_TUD_MIDI; i++)
   {
     midid_interface_t* midi = &_midid_itf[i];
+
+    // skip interfaces opened on other roothub port
+    if ( midi->rhport != rhport ) continue;
+
     tu_memclr(midi, ITF_MEM_RESET_SIZE);
     tu_fifo_clear(&midi->rx_ff);
     tu_fifo_clear(&midi->tx_ff);
@@ -278,6 +283,7 @@ bool midid_open(uint8_t rhport, tusb_desc_interface_t const * p_interface_desc,
     }
   }
 
+  p_midi->rhport   = rhport;
   p_midi->itf_num  = p_interface_desc->bInterfaceNumber;
 
   uint8_t const * p_desc = tu_desc_next( (uint8_t const *) p_interface_desc );
@@ -304,7 +310,7 @@ bool midid_open(uint8_t rhport, tusb_desc_interface_t const * p_interface_desc,
   }
 
   // Prepare for incoming data
-  TU_ASSERT( dcd_edpt_xfer(rhport, p_midi->ep_out, p_midi->epout_buf, CFG_TUD_MIDI_EPSIZE), false);
+  TU_ASSERT( usbd_edpt_xfer(rhport, p_midi->ep_out, p_midi->epout_buf, CFG_TUD_MIDI_EPSIZE), false);
 
   return true;
 }
@@ -334,7 +340,7 @@ bool midid_xfer_cb(uint8_t rhport, uint8_t edpt_addr, xfer_result_t result, uint
     midi_rx_done_cb(p_midi, p_midi->epout_buf, xferred_bytes);
 
     // prepare for next
-    TU_ASSERT( dcd_edpt_xfer(rhport, p_midi->ep_out, p_midi->epout_buf, CFG_TUD_MIDI_EPSIZE), false );
+    TU_ASSERT( usbd_edpt_xfer(rhport, p_midi->ep_out, p_midi->epout_buf, CFG_TUD_MIDI_EPSIZE), false );
   } else if ( edpt_addr == p_midi->ep_in ) {
     maybe_transmit(p_midi, itf);
   }
@@ -62,6 +62,9 @@
   #define ATTR_DEPRECATED(mess)      __attribute__ ((deprecated(mess))) // warn if function with this attribute is used
   #define ATTR_UNUSED                __attribute__ ((unused))           // Function/Variable is meant to be possibly unused
 
+  // Memory accesses are not reordered across this point by compiler and cpu
+  #define TU_MEM_BARRIER()           __sync_synchronize()
+
   // Endian conversion use well-known host to network (big endian) naming
   #if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
     #define tu_htonl(u32)  __builtin_bswap32(u32)
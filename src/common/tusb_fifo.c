@@ -55,8 +55,101 @@ static void tu_fifo_unlock(tu_fifo_t *f)
 
 #endif
 
+// Read and write index run freely in [0, 2*depth) so that full (difference is depth) and
+// empty (difference is 0) can be told apart without a count shared between producer and consumer.
+// Advance an index by n items (n <= depth), wrapping around without modulo
+static inline uint16_t _ff_advance(tu_fifo_t* f, uint16_t idx, uint16_t n)
+{
+  uint32_t next = idx + n;
+  if ( next >= 2u*f->depth ) next -= 2u*f->depth;
+  return (uint16_t) next;
+}
+
+// Buffer position of an index
+static inline uint16_t _ff_pos(tu_fifo_t* f, uint16_t idx)
+{
+  return (idx >= f->depth) ? (idx - f->depth) : idx;
+}
+
+// Copy n items out of the buffer starting at index, at most 2 memcpy when wrapped around
+static void _ff_pull_n(tu_fifo_t* f, void * p_buffer, uint16_t idx, uint16_t n)
+{
+  uint16_t const lin_count = f->depth - idx; // items until end of buffer
+
+  if ( n <= lin_count )
+  {
+    memcpy(p_buffer, f->buffer + (idx * f->item_size), n * f->item_size);
+  }
+  else
+  {
+    uint16_t const lin_bytes = lin_count * f->item_size;
+
+    memcpy(p_buffer, f->buffer + (idx * f->item_size), lin_bytes);
+    memcpy(((uint8_t*) p_buffer) + lin_bytes, f->buffer, (n - lin_count) * f->item_size);
+  }
+}
+
+// Copy n items into the buffer starting at index, at most 2 memcpy when wrapped around
+static void _ff_push_n(tu_fifo_t* f, void const * p_data, uint16_t idx, uint16_t n)
+{
+  uint16_t const lin_count = f->depth - idx; // items until end of buffer
+
+  if ( n <= lin_count )
+  {
+    memcpy(f->buffer + (idx * f->item_size), p_data, n * f->item_size);
+  }
+  else
+  {
+    uint16_t const lin_bytes = lin_count * f->item_size;
+
+    memcpy(f->buffer + (idx * f->item_size), p_data, lin_bytes);
+    memcpy(f->buffer, ((uint8_t const*) p_data) + lin_bytes, (n - lin_count) * f->item_size);
+  }
+}
+
+// Reserve up to n free items after the previous reservations, caller must hold the lock.
+// Without mutex there is no lock, the fifo must have a single producer then.
+// Update n to the number of reserved items, return false if nothing is reserved and must not be committed.
+static bool _ff_reserve(tu_fifo_t* f, uint16_t* p_n, uint16_t* p_pos)
+{
+  uint16_t const rsv_idx = f->wr_rsv_idx;
+  uint8_t  const pending = f->rsv_pending;
+
+  TU_ASSERT(pending < UINT8_MAX);
+
+  uint16_t const n = tu_min16(*p_n, f->depth - _tu_fifo_count(f, rsv_idx, f->rd_idx));
+
+  // Reservation changed under us: another producer (e.g isr preempting main loop) without a mutex
+  TU_ASSERT( (rsv_idx == f->wr_rsv_idx) && (pending == f->rsv_pending) );
+
+  (*p_pos) = _ff_pos(f, rsv_idx);
+  (*p_n)   = n;
+  f->wr_rsv_idx  = _ff_advance(f, rsv_idx, n);
+  f->rsv_pending = (uint8_t) (pending + 1);
+
+  return true;
+}
+
+// Commit a reservation, caller must hold the lock.
+// Publish everything reserved so far when the last pending reservation is committed,
+// this keeps data in reservation order without any producer waiting for another.
+static void _ff_commit(tu_fifo_t* f)
+{
+  TU_ASSERT(f->rsv_pending > 0, );
+
+  if ( --f->rsv_pending == 0 )
+  {
+    // data must be in place before it is published to consumer
+    TU_MEM_BARRIER();
+    f->wr_idx = f->wr_rsv_idx;
+  }
+}
+
 bool tu_fifo_config(tu_fifo_t *f, void* buffer, uint16_t depth, uint16_t item_size, bool overwritable)
 {
+  // index runs up to 2*depth
+  TU_ASSERT(depth <= 0x7fff);
+
   tu_fifo_lock(f);
 
   f->buffer = (uint8_t*) buffer;
@@ -64,7 +157,8 @@ bool tu_fifo_config(tu_fifo_t *f, void* buffer, uint16_t depth, uint16_t item_si
   f->item_size = item_size;
   f->overwritable = overwritable;
 
-  f->rd_idx = f->wr_idx = f->count = 0;
+  f->rd_idx = f->wr_idx = f->wr_rsv_idx = 0;
+  f->rsv_pending = 0;
 
   tu_fifo_unlock(f);
 
@@ -90,19 +184,7 @@ bool tu_fifo_config(tu_fifo_t *f, void* buffer, uint16_t depth, uint16_t item_si
 /******************************************************************************/
 bool tu_fifo_read(tu_fifo_t* f, void * p_buffer)
 {
-  if( tu_fifo_empty(f) ) return false;
-
-  tu_fifo_lock(f);
-
-  memcpy(p_buffer,
-         f->buffer + (f->rd_idx * f->item_size),
-         f->item_size);
-  f->rd_idx = (f->rd_idx + 1) % f->depth;
-  f->count--;
-
-  tu_fifo_unlock(f);
-
-  return true;
+  return tu_fifo_read_n(f, p_buffer, 1) == 1;
 }
 
 /******************************************************************************/
@@ -125,24 +207,27 @@ uint16_t tu_fifo_read_n (tu_fifo_t* f, void * p_buffer, uint16_t count)
 {
   if( tu_fifo_empty(f) ) return 0;
 
+  tu_fifo_lock(f);
+
+  // Consumer only modifies read index
+  uint16_t const rd_idx = f->rd_idx;
+
   /* Limit up to fifo's count */
-  if ( count > f->count ) count = f->count;
+  count = tu_min16(count, _tu_fifo_count(f, f->wr_idx, rd_idx));
 
   /* Could copy up to 2 portions marked as 'x' if queue is wrapped around
    * case 1: ....RxxxxW.......
    * case 2: xxxxxW....Rxxxxxx
    */
-//  uint16_t index2upper = tu_min16(count, f->count-f->rd_idx);
+  _ff_pull_n(f, p_buffer, _ff_pos(f, rd_idx), count);
 
-  uint8_t* p_buf = (uint8_t*) p_buffer;
-  uint16_t len = 0;
-  while( (len < count) && tu_fifo_read(f, p_buf) )
-  {
-    len++;
-    p_buf += f->item_size;
-  }
+  // data must be copied out before its slots are released to producer
+  TU_MEM_BARRIER();
+  f->rd_idx = _ff_advance(f, rd_idx, count);
+
+  tu_fifo_unlock(f);
 
-  return len;
+  return count;
 }
 
 /******************************************************************************/
@@ -161,10 +246,12 @@ uint16_t tu_fifo_read_n (tu_fifo_t* f, void * p_buffer, uint16_t count)
 /******************************************************************************/
 bool tu_fifo_peek_at(tu_fifo_t* f, uint16_t pos, void * p_buffer)
 {
-  if ( pos >= f->count ) return false;
+  uint16_t const rd_idx = f->rd_idx;
+
+  if ( pos >= _tu_fifo_count(f, f->wr_idx, rd_idx) ) return false;
 
   // rd_idx is pos=0
-  uint16_t index = (f->rd_idx + pos) % f->depth;
+  uint16_t index = _ff_pos(f, _ff_advance(f, rd_idx, pos));
   memcpy(p_buffer,
          f->buffer + (index * f->item_size),
          f->item_size);
@@ -172,6 +259,73 @@ bool tu_fifo_peek_at(tu_fifo_t* f, uint16_t pos, void * p_buffer)
   return true;
 }
 
+/******************************************************************************/
+/*!
+    @brief Reads n items without removing them from the FIFO
+
+    @param[in]  f
+                Pointer to the FIFO buffer to manipulate
+    @param[in]  p_buffer
+                Pointer to the place holder for data read from the buffer
+    @param[in]  count
+                Number of element that buffer can afford
+
+    @returns number of items peeked from the FIFO
+*/
+/******************************************************************************/
+uint16_t tu_fifo_peek_n(tu_fifo_t* f, void * p_buffer, uint16_t count)
+{
+  uint16_t const rd_idx = f->rd_idx;
+
+  count = tu_min16(count, _tu_fifo_count(f, f->wr_idx, rd_idx));
+  _ff_pull_n(f, p_buffer, _ff_pos(f, rd_idx), count);
+
+  return count;
+}
+
+/******************************************************************************/
+/*!
+    @brief Search a byte FIFO (item_size = 1) for a value, memchr-style on
+    both sides of the wrap point
+
+    @param[in]  f
+                Pointer to the FIFO buffer to manipulate
+    @param[in]  value
+                Byte to search for
+    @param[out] p_pos
+                Position of the first occurrence, relative to the read pointer
+
+    @returns TRUE if the value is found, always FALSE if item size is not 1
+*/
+/******************************************************************************/
+bool tu_fifo_find(tu_fifo_t* f, uint8_t value, uint16_t* p_pos)
+{
+  // value is compared byte by byte, position would be wrong for larger items
+  TU_VERIFY(f->item_size == 1);
+
+  tu_fifo_buffer_info_t info;
+  tu_fifo_get_read_info(f, &info);
+
+  uint8_t const* p_found = (uint8_t const*) memchr(info.ptr_lin, value, info.len_lin);
+  if ( p_found )
+  {
+    (*p_pos) = (uint16_t) (p_found - (uint8_t const*) info.ptr_lin);
+    return true;
+  }
+
+  if ( info.len_wrap )
+  {
+    p_found = (uint8_t const*) memchr(info.ptr_wrap, value, info.len_wrap);
+    if ( p_found )
+    {
+      (*p_pos) = (uint16_t) (info.len_lin + (p_found - (uint8_t const*) info.ptr_wrap));
+      return true;
+    }
+  }
+
+  return false;
+}
+
 /******************************************************************************/
 /*!
     @brief Write one element into the RX buffer.
@@ -191,64 +345,245 @@ bool tu_fifo_peek_at(tu_fifo_t* f, uint16_t pos, void * p_buffer)
 /******************************************************************************/
 bool tu_fifo_write (tu_fifo_t* f, const void * p_data)
 {
-  if ( tu_fifo_full(f) && !f->overwritable ) return false;
+  return tu_fifo_write_n(f, p_data, 1) == 1;
+}
+
+/******************************************************************************/
+/*!
+    @brief This function will write n elements into the array index specified by
+    the write pointer and increment the write index. If the write index
+    exceeds the max buffer size, then it will roll over to zero.
+
+    @param[in]  f
+                Pointer to the FIFO buffer to manipulate
+    @param[in]  p_data
+                The pointer to data to add to the FIFO
+    @param[in]  count
+                Number of element
+    @return Number of written elements
+*/
+/******************************************************************************/
+uint16_t tu_fifo_write_n (tu_fifo_t* f, const void * p_data, uint16_t count)
+{
+  if ( count == 0 ) return 0;
+
+  uint8_t const* p_buf = (uint8_t const*) p_data;
+
+  if ( !f->overwritable )
+  {
+    // Reserve space then copy without holding the lock
+    uint16_t pos;
+
+    tu_fifo_lock(f);
+    bool const reserved = _ff_reserve(f, &count, &pos);
+    tu_fifo_unlock(f);
+
+    if ( !reserved ) return 0;
+
+    _ff_push_n(f, p_buf, pos, count);
+
+    tu_fifo_lock(f);
+    _ff_commit(f);
+    tu_fifo_unlock(f);
+
+    return count;
+  }
+
+  uint16_t const written = count;
 
   tu_fifo_lock(f);
 
-  memcpy( f->buffer + (f->wr_idx * f->item_size),
-          p_data,
-          f->item_size);
+  // Overwritable fifo is always written with the lock held since it also moves the read index
+  uint16_t const wr_idx = f->wr_idx;
+  uint16_t const ff_count = _tu_fifo_count(f, wr_idx, f->rd_idx);
+
+  // Only the last depth items can survive, skip the ones that would be overwritten anyway
+  if ( count > f->depth )
+  {
+    p_buf += (count - f->depth) * f->item_size;
+    count  = f->depth;
+  }
+
+  _ff_push_n(f, p_buf, _ff_pos(f, wr_idx), count);
 
-  f->wr_idx = (f->wr_idx + 1) % f->depth;
+  // data must be in place before it is published to consumer
+  TU_MEM_BARRIER();
+  f->wr_idx = f->wr_rsv_idx = _ff_advance(f, wr_idx, count);
 
-  if (tu_fifo_full(f))
+  if ( ff_count + count > f->depth )
   {
-    f->rd_idx = f->wr_idx; // keep the full state (rd == wr && len = size)
+    // oldest items are overwritten, keep the full state (wr - rd = depth)
+    f->rd_idx = _ff_advance(f, f->wr_idx, f->depth);
+  }
+
+  tu_fifo_unlock(f);
+
+  return written;
+}
+
+// Split n items starting at buffer position into linear and wrapped part
+static void _ff_buffer_info(tu_fifo_t* f, tu_fifo_buffer_info_t* info, uint16_t pos, uint16_t n)
+{
+  uint16_t const lin_count = f->depth - pos; // items until end of buffer
+
+  info->ptr_lin = f->buffer + (pos * f->item_size);
+
+  if ( n <= lin_count )
+  {
+    info->len_lin  = n;
+    info->len_wrap = 0;
+    info->ptr_wrap = NULL;
   }
   else
   {
-    f->count++;
+    info->len_lin  = lin_count;
+    info->len_wrap = n - lin_count;
+    info->ptr_wrap = f->buffer;
   }
+}
+
+/******************************************************************************/
+/*!
+    @brief Get the readable region without copying it out. Items are only
+    removed from the FIFO by tu_fifo_advance_read_pointer().
+
+    @param[in]  f
+                Pointer to the FIFO buffer to manipulate
+    @param[out] info
+                Linear and wrapped part of the readable items
+*/
+/******************************************************************************/
+void tu_fifo_get_read_info(tu_fifo_t* f, tu_fifo_buffer_info_t* info)
+{
+  uint16_t const rd_idx = f->rd_idx;
+  _ff_buffer_info(f, info, _ff_pos(f, rd_idx), _tu_fifo_count(f, f->wr_idx, rd_idx));
+}
+
+/******************************************************************************/
+/*!
+    @brief Get the writable region without copying into it. Items are only
+    added to the FIFO by tu_fifo_advance_write_pointer(). Overwritable FIFO
+    also only reports its free space.
+
+    @param[in]  f
+                Pointer to the FIFO buffer to manipulate
+    @param[out] info
+                Linear and wrapped part of the free space
+*/
+/******************************************************************************/
+void tu_fifo_get_write_info(tu_fifo_t* f, tu_fifo_buffer_info_t* info)
+{
+  uint16_t const wr_idx = f->wr_idx;
+  _ff_buffer_info(f, info, _ff_pos(f, wr_idx), f->depth - _tu_fifo_count(f, wr_idx, f->rd_idx));
+}
+
+/******************************************************************************/
+/*!
+    @brief Remove n items that were consumed in place after
+    tu_fifo_get_read_info()
+
+    @param[in]  f
+                Pointer to the FIFO buffer to manipulate
+    @param[in]  n
+                Number of items consumed, up to the reported length
+*/
+/******************************************************************************/
+void tu_fifo_advance_read_pointer(tu_fifo_t* f, uint16_t n)
+{
+  tu_fifo_lock(f);
+
+  TU_MEM_BARRIER();
+  f->rd_idx = _ff_advance(f, f->rd_idx, n);
 
   tu_fifo_unlock(f);
+}
 
-  return true;
+/******************************************************************************/
+/*!
+    @brief Publish n items that were produced in place after
+    tu_fifo_get_write_info(). Must not be used while a reservation made by
+    tu_fifo_reserve() is pending.
+
+    @param[in]  f
+                Pointer to the FIFO buffer to manipulate
+    @param[in]  n
+                Number of items produced, up to the reported length
+*/
+/******************************************************************************/
+void tu_fifo_advance_write_pointer(tu_fifo_t* f, uint16_t n)
+{
+  // would overwrite space handed out by tu_fifo_reserve()
+  TU_ASSERT(f->rsv_pending == 0, );
+
+  tu_fifo_lock(f);
+
+  TU_MEM_BARRIER();
+  f->wr_idx = f->wr_rsv_idx = _ff_advance(f, f->wr_idx, n);
+
+  tu_fifo_unlock(f);
 }
 
 /******************************************************************************/
 /*!
-    @brief This function will write n elements into the array index specified by
-    the write pointer and increment the write index. If the write index
-    exceeds the max buffer size, then it will roll over to zero.
+    @brief Reserve space for n items, to be filled without holding the lock.
+    The reservation is all or nothing so that a message is never split with
+    data from another producer. Items become readable after tu_fifo_commit().
 
     @param[in]  f
                 Pointer to the FIFO buffer to manipulate
-    @param[in]  p_data
-                The pointer to data to add to the FIFO
-    @param[in]  count
-                Number of element
-    @return Number of written elements
+    @param[in]  n
+                Number of items to reserve
+    @param[out] info
+                Linear and wrapped part of the reserved space
+
+    @returns TRUE if there is enough free space
 */
 /******************************************************************************/
-uint16_t tu_fifo_write_n (tu_fifo_t* f, const void * p_data, uint16_t count)
+bool tu_fifo_reserve(tu_fifo_t* f, uint16_t n, tu_fifo_buffer_info_t* info)
 {
-  if ( count == 0 ) return 0;
+  TU_VERIFY(!f->overwritable);
 
-  uint8_t const* p_buf = (uint8_t const*) p_data;
+  tu_fifo_lock(f);
 
-  uint16_t len = 0;
-  while( (len < count) && tu_fifo_write(f, p_buf) )
+  if ( n > f->depth - _tu_fifo_count(f, f->wr_rsv_idx, f->rd_idx) )
   {
-    len++;
-    p_buf += f->item_size;
+    tu_fifo_unlock(f);
+    return false;
   }
 
-  return len;
+  uint16_t pos;
+  bool const reserved = _ff_reserve(f, &n, &pos);
+
+  tu_fifo_unlock(f);
+
+  TU_VERIFY(reserved);
+
+  _ff_buffer_info(f, info, pos, n);
+
+  return true;
+}
+
+/******************************************************************************/
+/*!
+    @brief Commit a reservation made by tu_fifo_reserve() once its data is
+    copied. Data is published in reservation order once no reservation is
+    pending anymore.
+
+    @param[in]  f
+                Pointer to the FIFO buffer to manipulate
+*/
+/******************************************************************************/
+void tu_fifo_commit(tu_fifo_t* f)
+{
+  tu_fifo_lock(f);
+  _ff_commit(f);
+  tu_fifo_unlock(f);
 }
 
 /******************************************************************************/
 /*!
-    @brief Clear the fifo read and write pointers and set length to zero
+    @brief Drop all unread items. Only the read pointer is moved (to the
+    write pointer), pointers are not rewound to the start of the buffer.
 
     @param[in]  f
                 Pointer to the FIFO buffer to manipulate
@@ -258,7 +593,8 @@ bool tu_fifo_clear(tu_fifo_t *f)
 {
   tu_fifo_lock(f);
 
-  f->rd_idx = f->wr_idx = f->count = 0;
+  // Only consumer's index is touched so that it is safe against a concurrent producer
+  f->rd_idx = f->wr_idx;
 
   tu_fifo_unlock(f);
 
@@ -35,6 +35,13 @@
 // for OS None, we don't get preempted
 #define CFG_FIFO_MUTEX      (CFG_TUSB_OS != OPT_OS_NONE)
 
+// Opt-in lock-free data path: application guarantees that each class fifo has a single producer and
+// a single consumer (e.g one task reads and one task writes a CDC/MIDI interface, the other side being
+// usbd task). Class drivers then configure no mutex and no overwritable fifo.
+#ifndef CFG_FIFO_SPSC
+#define CFG_FIFO_SPSC       0
+#endif
+
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -49,17 +56,29 @@
 
 /** \struct tu_fifo_t
  * \brief Simple Circular FIFO
+ *
+ * Write index is only modified by producer and read index only by consumer. Therefore a
+ * non-overwritable fifo with a single producer and a single consumer (e.g ISR and task) is
+ * lock-free and does not need a mutex. Mutex is only required for multiple producers/consumers
+ * or overwritable fifo.
+ *
+ * Multiple producers reserve space with the mutex held briefly, copy their data without lock,
+ * then commit. Reserved data is published once all pending reservations are committed.
+ * Without mutex there is no lock at all, writes (including tu_fifo_write_n) must come from a
+ * single producer.
  */
 typedef struct
 {
            uint8_t* buffer    ; ///< buffer pointer
-           uint16_t depth     ; ///< max items
+           uint16_t depth     ; ///< max items, up to 0x7fff
            uint16_t item_size ; ///< size of each item
            bool overwritable  ;
 
-  volatile uint16_t count     ; ///< number of items in queue
-  volatile uint16_t wr_idx    ; ///< write pointer
-  volatile uint16_t rd_idx    ; ///< read pointer
+  volatile uint16_t wr_idx    ; ///< write pointer, runs in [0, 2*depth)
+  volatile uint16_t rd_idx    ; ///< read pointer, runs in [0, 2*depth)
+
+           uint16_t wr_rsv_idx  ; ///< end of reserved space, equal to wr_idx if nothing is pending
+           uint8_t  rsv_pending ; ///< number of reservations not yet committed
 
 #if CFG_FIFO_MUTEX
   tu_fifo_mutex_t mutex;
@@ -67,6 +86,17 @@ typedef struct
 
 } tu_fifo_t;
 
+/** \struct tu_fifo_buffer_info_t
+ * \brief Readable or writable region of a fifo, split in two parts when wrapped around
+ */
+typedef struct
+{
+  uint16_t len_lin  ; ///< linear length in items
+  uint16_t len_wrap ; ///< wrapped length in items, starting at beginning of buffer
+  void*    ptr_lin  ; ///< linear part start pointer
+  void*    ptr_wrap ; ///< wrapped part start pointer (buffer start), NULL if len_wrap is 0
+} tu_fifo_buffer_info_t;
+
 #define TU_FIFO_DEF(_name, _depth, _type, _overwritable) \
   uint8_t _name##_buf[_depth*sizeof(_type)]; \
   tu_fifo_t _name = {                        \
@@ -76,6 +106,8 @@ typedef struct
       .overwritable = _overwritable,         \
   }
 
+// Drop all unread items by moving read index up to write index. Indices are not rewound to zero
+// (only tu_fifo_config() does that) so that it is safe against a concurrent producer.
 bool tu_fifo_clear(tu_fifo_t *f);
 bool tu_fifo_config(tu_fifo_t *f, void* buffer, uint16_t depth, uint16_t item_size, bool overwritable);
 
@@ -93,30 +125,54 @@ bool     tu_fifo_read    (tu_fifo_t* f, void * p_buffer);
 uint16_t tu_fifo_read_n  (tu_fifo_t* f, void * p_buffer, uint16_t count);
 
 bool     tu_fifo_peek_at (tu_fifo_t* f, uint16_t pos, void * p_buffer);
+uint16_t tu_fifo_peek_n  (tu_fifo_t* f, void * p_buffer, uint16_t count);
+
+// Byte fifo only (item_size = 1, otherwise return false): position of first occurrence of value
+bool     tu_fifo_find    (tu_fifo_t* f, uint8_t value, uint16_t* p_pos);
+
+// Zero-copy access e.g for DMA: get the readable/writable region, work on it directly,
+// then commit the number of items actually consumed/produced
+void     tu_fifo_get_read_info        (tu_fifo_t* f, tu_fifo_buffer_info_t* info);
+void     tu_fifo_get_write_info       (tu_fifo_t* f, tu_fifo_buffer_info_t* info);
+void     tu_fifo_advance_read_pointer (tu_fifo_t* f, uint16_t n);
+void     tu_fifo_advance_write_pointer(tu_fifo_t* f, uint16_t n);
+
+// Multiple producers: reserve space for a whole message, copy into it without holding the lock,
+// then commit. Not supported by overwritable fifo, nor mixed with tu_fifo_advance_write_pointer().
+// Multiple producers require a mutex (CFG_FIFO_MUTEX), without it reserve/commit and tu_fifo_write_n()
+// are for a single producer only: concurrent reservations are asserted. Up to 255 can be pending.
+bool     tu_fifo_reserve(tu_fifo_t* f, uint16_t n, tu_fifo_buffer_info_t* info);
+void     tu_fifo_commit (tu_fifo_t* f);
 
 static inline bool tu_fifo_peek(tu_fifo_t* f, void * p_buffer)
 {
   return tu_fifo_peek_at(f, 0, p_buffer);
 }
 
-static inline bool tu_fifo_empty(tu_fifo_t* f)
+// number of items between write and read index
+static inline uint16_t _tu_fifo_count(tu_fifo_t* f, uint16_t wr_idx, uint16_t rd_idx)
 {
-  return (f->count == 0);
+  return (wr_idx >= rd_idx) ? (wr_idx - rd_idx) : (2*f->depth - (rd_idx - wr_idx));
 }
 
-static inline bool tu_fifo_full(tu_fifo_t* f)
+static inline bool tu_fifo_empty(tu_fifo_t* f)
 {
-  return (f->count == f->depth);
+  return (f->wr_idx == f->rd_idx);
 }
 
 static inline uint16_t tu_fifo_count(tu_fifo_t* f)
 {
-  return f->count;
+  return _tu_fifo_count(f, f->wr_idx, f->rd_idx);
+}
+
+static inline bool tu_fifo_full(tu_fifo_t* f)
+{
+  return (tu_fifo_count(f) == f->depth);
 }
 
 static inline uint16_t tu_fifo_remaining(tu_fifo_t* f)
 {
-  return f->depth - f->count;
+  return f->depth - tu_fifo_count(f);
 }
 
 static inline uint16_t tu_fifo_depth(tu_fifo_t* f)
@@ -124,6 +180,74 @@ static inline uint16_t tu_fifo_depth(tu_fifo_t* f)
   return f->depth;
 }
 
+//--------------------------------------------------------------------+
+// Typed FIFO
+// Item type and power-of-two depth are known at compile time, therefore items are copied by
+// assignment and indices are masked instead of computing offset with item_size and depth.
+// Generated functions are bound to the fifo instance e.g TU_FIFO_TYPED_DEF(evt_ff, 16, event_t)
+// gives evt_ff_write(), evt_ff_read() etc... Same as tu_fifo_t, it is lock-free for a single
+// producer and a single consumer. Indices run freely as uint16_t, depth is up to 0x8000.
+//--------------------------------------------------------------------+
+#define TU_FIFO_TYPED_DEF(_name, _depth, _type) \
+  TU_VERIFY_STATIC( (((_depth) & ((_depth)-1)) == 0) && ((_depth) <= 0x8000), "depth must be power of 2"); \
+  \
+  static struct { \
+    _type buffer[_depth]; \
+    volatile uint16_t wr_idx; \
+    volatile uint16_t rd_idx; \
+  } _name; \
+  \
+  static inline uint16_t _name##_count(void) { return (uint16_t) (_name.wr_idx - _name.rd_idx); } \
+  static inline bool _name##_empty(void) { return _name.wr_idx == _name.rd_idx; } \
+  static inline bool _name##_full (void) { return _name##_count() == (_depth); } \
+  static inline void _name##_clear(void) { _name.rd_idx = _name.wr_idx; } \
+  \
+  static inline bool _name##_write(_type const* p_data) \
+  { \
+    uint16_t const wr_idx = _name.wr_idx; \
+    if ( (uint16_t) (wr_idx - _name.rd_idx) == (_depth) ) return false; \
+    _name.buffer[wr_idx & ((_depth)-1)] = (*p_data); \
+    TU_MEM_BARRIER(); \
+    _name.wr_idx = (uint16_t) (wr_idx + 1); \
+    return true; \
+  } \
+  \
+  static inline bool _name##_read(_type* p_data) \
+  { \
+    uint16_t const rd_idx = _name.rd_idx; \
+    if ( _name.wr_idx == rd_idx ) return false; \
+    (*p_data) = _name.buffer[rd_idx & ((_depth)-1)]; \
+    TU_MEM_BARRIER(); \
+    _name.rd_idx = (uint16_t) (rd_idx + 1); \
+    return true; \
+  } \
+  \
+  static inline uint16_t _name##_write_n(_type const* p_data, uint16_t count) \
+  { \
+    uint16_t const wr_idx = _name.wr_idx; \
+    uint16_t const pos    = wr_idx & ((_depth)-1); \
+    count = tu_min16(count, (uint16_t) ((_depth) - (uint16_t) (wr_idx - _name.rd_idx))); \
+    uint16_t const lin_count = tu_min16(count, (uint16_t) ((_depth) - pos)); \
+    memcpy(&_name.buffer[pos], p_data, lin_count*sizeof(_type)); \
+    memcpy(&_name.buffer[0], p_data + lin_count, (count - lin_count)*sizeof(_type)); \
+    TU_MEM_BARRIER(); \
+    _name.wr_idx = (uint16_t) (wr_idx + count); \
+    return count; \
+  } \
+  \
+  static inline uint16_t _name##_read_n(_type* p_data, uint16_t count) \
+  { \
+    uint16_t const rd_idx = _name.rd_idx; \
+    uint16_t const pos    = rd_idx & ((_depth)-1); \
+    count = tu_min16(count, (uint16_t) (_name.wr_idx - rd_idx)); \
+    uint16_t const lin_count = tu_min16(count, (uint16_t) ((_depth) - pos)); \
+    memcpy(p_data, &_name.buffer[pos], lin_count*sizeof(_type)); \
+    memcpy(p_data + lin_count, &_name.buffer[0], (count - lin_count)*sizeof(_type)); \
+    TU_MEM_BARRIER(); \
+    _name.rd_idx = (uint16_t) (rd_idx + count); \
+    return count; \
+  }
+
 #ifdef __cplusplus
  }
 #endif
@@ -83,6 +83,8 @@ typedef enum
   TUSB_DESC_OTG                   = 0x09 ,
   TUSB_DESC_DEBUG                 = 0x0A ,
   TUSB_DESC_INTERFACE_ASSOCIATION = 0x0B ,
+  TUSB_DESC_BOS                   = 0x0F ,
+  TUSB_DESC_DEVICE_CAPABILITY     = 0x10 ,
   TUSB_DESC_CLASS_SPECIFIC        = 0x24
 }tusb_desc_type_t;
 
@@ -169,6 +171,21 @@ enum {
 
 #define TUSB_DESC_CONFIG_POWER_MA(x)  ((x)/2)
 
+/// Device Capability Types of BOS descriptor
+typedef enum
+{
+  DEVICE_CAPABILITY_WIRELESS_USB      = 0x01,
+  DEVICE_CAPABILITY_USB20_EXTENSION   = 0x02,
+  DEVICE_CAPABILITY_SUPERSPEED_USB    = 0x03,
+  DEVICE_CAPABILITY_CONTAINER_ID      = 0x04,
+  DEVICE_CAPABILITY_PLATFORM          = 0x05,
+}device_capability_type_t;
+
+enum {
+  TUSB_USB20_EXT_ATT_LPM        = TU_BIT(1), ///< Link Power Management (L1) supported
+  TUSB_USB20_EXT_ATT_BESL       = TU_BIT(2), ///< BESL and alternate HIRD definitions supported
+};
+
 /// Device State TODO remove
 typedef enum
 {
@@ -303,6 +320,24 @@ typedef struct ATTR_PACKED
   uint8_t  bReserved          ; ///< Reserved for future use, must be zero
 } tusb_desc_device_qualifier_t;
 
+/// USB Binary Device Object Store (BOS) Descriptor (USB 2.0 LPM ECN)
+typedef struct ATTR_PACKED
+{
+  uint8_t  bLength         ; ///< Size of this descriptor in bytes
+  uint8_t  bDescriptorType ; ///< BOS Type
+  uint16_t wTotalLength    ; ///< Total length of this descriptor and all of its device capability descriptors
+  uint8_t  bNumDeviceCaps  ; ///< Number of device capability descriptors in the BOS
+} tusb_desc_bos_t;
+
+/// USB 2.0 Extension Device Capability Descriptor (USB 2.0 LPM ECN)
+typedef struct ATTR_PACKED
+{
+  uint8_t  bLength            ; ///< Size of this descriptor in bytes
+  uint8_t  bDescriptorType    ; ///< Device Capability Type
+  uint8_t  bDevCapabilityType ; ///< USB 2.0 Extension capability
+  uint32_t bmAttributes       ; ///< Bit 1 LPM supported, bit 2 BESL and alternate HIRD definitions supported
+} tusb_desc_usb20_ext_t;
+
 /// USB Interface Association Descriptor (IAD ECN)
 typedef struct ATTR_PACKED
 {
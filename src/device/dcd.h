@@ -44,6 +44,8 @@ typedef enum
   DCD_EVENT_SOF,
   DCD_EVENT_SUSPEND,
   DCD_EVENT_RESUME,
+  DCD_EVENT_LPM_SLEEP,  // link entered L1 sleep
+  DCD_EVENT_LPM_RESUME, // link resumed from L1, port may report it as DCD_EVENT_RESUME as well
 
   DCD_EVENT_SETUP_RECEIVED,
   DCD_EVENT_XFER_COMPLETE,
@@ -56,8 +58,20 @@ typedef struct ATTR_ALIGNED(4)
 {
   uint8_t rhport;
   uint8_t event_id;
+  uint8_t bus_gen;  // set by usbd when queued, dcd does not need to fill it
 
   union {
+    // DCD_EVENT_BUS_RESET
+    struct {
+      tusb_speed_t speed; // negotiated speed, zero (full speed) if sent by dcd_event_bus_signal()
+    }bus_reset;
+
+    // DCD_EVENT_LPM_SLEEP
+    struct {
+      uint8_t besl;          // Best Effort Service Latency of the LPM token
+      bool    remote_wakeup; // bRemoteWake of the LPM token
+    }lpm_sleep;
+
     // USBD_EVT_SETUP_RECEIVED
     tusb_control_request_t setup_received;
 
@@ -100,6 +114,16 @@ void dcd_set_config (uint8_t rhport, uint8_t config_num);
 // Wake up host
 void dcd_remote_wakeup(uint8_t rhport);
 
+// Enable/Disable Start-of-Frame interrupt, disabled by default. Optional, port without it never
+// generates SOF event or always generates it regardless of subscription.
+ATTR_WEAK void dcd_sof_enable(uint8_t rhport, bool en);
+
+// Enable/Disable acknowledging LPM transaction, disabled by default (host LPM request gets no handshake,
+// or NYET depending on hardware, and the link stays in L0).
+// Optional, only for port whose hardware supports USB 2.0 Link Power Management. dcd_remote_wakeup()
+// must also be able to wake host up from L1.
+ATTR_WEAK void dcd_lpm_enable(uint8_t rhport, bool en);
+
 /*------------------------------------------------------------------*/
 /* Endpoint API
  *  - open        : Configure endpoint's registers
@@ -108,6 +132,7 @@ void dcd_remote_wakeup(uint8_t rhport);
  *  - busy        : Check if endpoint transferring is complete (TODO remove)
  *  - stall       : stall endpoint
  *  - clear_stall : clear stall, data toggle is also reset to DATA0
+ *  - close       : disable endpoint (optional)
  *------------------------------------------------------------------*/
 bool dcd_edpt_open        (uint8_t rhport, tusb_desc_endpoint_t const * p_endpoint_desc);
 bool dcd_edpt_xfer        (uint8_t rhport, uint8_t ep_addr, uint8_t * buffer, uint16_t total_bytes);
@@ -116,6 +141,10 @@ bool dcd_edpt_busy        (uint8_t rhport, uint8_t ep_addr);
 void dcd_edpt_stall       (uint8_t rhport, uint8_t ep_addr);
 void dcd_edpt_clear_stall (uint8_t rhport, uint8_t ep_addr);
 
+// Close an endpoint, transfer in progress is aborted. Optional, required by class driver switching
+// alternate settings, so that endpoint can be opened again with another type and/or size.
+ATTR_WEAK void dcd_edpt_close (uint8_t rhport, uint8_t ep_addr);
+
 /*------------------------------------------------------------------*/
 /* Event Function
  * Called by DCD to notify USBD
@@ -125,6 +154,12 @@ void dcd_event_handler(dcd_event_t const * event, bool in_isr);
 // helper to send bus signal event
 void dcd_event_bus_signal (uint8_t rhport, dcd_eventid_t eid, bool in_isr);
 
+// helper to send bus reset event with negotiated speed, high speed capable port must use this
+void dcd_event_bus_reset (uint8_t rhport, tusb_speed_t speed, bool in_isr);
+
+// helper to send LPM sleep event with attributes of the LPM token
+void dcd_event_lpm_sleep (uint8_t rhport, uint8_t besl, bool remote_wakeup, bool in_isr);
+
 // helper to send setup received
 void dcd_event_setup_received(uint8_t rhport, uint8_t const * setup, bool in_isr);
 
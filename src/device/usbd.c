@@ -31,34 +31,81 @@
 #include "tusb.h"
 #include "usbd.h"
 #include "device/usbd_pvt.h"
+#include "device/usbd_trace.h"
 
+// Depth of the event queue, shared by all device ports
 #ifndef CFG_TUD_TASK_QUEUE_SZ
 #define CFG_TUD_TASK_QUEUE_SZ   16
 #endif
 
+// Number of events drained from the queue at once by tud_task()
+#ifndef CFG_TUD_TASK_EVENT_BATCH
+#define CFG_TUD_TASK_EVENT_BATCH  4
+#endif
+
+// Depth of the high priority lane (per port) for SETUP/EP0 events, must be power of 2
+#ifndef CFG_TUD_TASK_QUEUE_HP_SZ
+#define CFG_TUD_TASK_QUEUE_HP_SZ  8
+#endif
+
+// Number of transfers that can be queued per endpoint while one is in progress
+#ifndef CFG_TUD_EDPT_XFER_QUEUE_SZ
+#define CFG_TUD_EDPT_XFER_QUEUE_SZ  2
+#endif
+
 //--------------------------------------------------------------------+
 // Device Data
 //--------------------------------------------------------------------+
+
+// Transfers waiting for the one in progress on the same endpoint
+typedef struct {
+  struct {
+    uint8_t* buffer;
+    uint16_t total_bytes;
+  } xfer[CFG_TUD_EDPT_XFER_QUEUE_SZ];
+
+  uint8_t rd_idx;
+  uint8_t count;
+} usbd_xfer_queue_t;
+
 typedef struct {
   struct ATTR_PACKED
   {
       volatile uint8_t connected    : 1;
       volatile uint8_t configured   : 1;
       volatile uint8_t suspended    : 1;
+      volatile uint8_t lpm_sleep    : 1; // link is in L1 sleep
 
       uint8_t remote_wakeup_en      : 1; // enable/disable by host
       uint8_t remote_wakeup_support : 1; // configuration descriptor's attribute
       uint8_t self_powered          : 1; // configuration descriptor's attribute
+      uint8_t lpm_remote_wakeup_en  : 1; // bRemoteWake of last LPM token
   };
 
-//  uint8_t ep_busy_mask[2];  // bit mask for busy endpoint
+  uint8_t speed;   // tusb_speed_t negotiated by bus reset
+  uint8_t cfg_num; // current configuration value, 0 if not configured
+  uint8_t bus_gen; // bus reset generation serviced by tud_task()
+
+  uint8_t sof_consumer;      // bit mask of class drivers subscribed to SOF
+  volatile bool sof_pending; // SOF event is in the queue, not yet processed
+
+  volatile uint8_t ep_busy_mask[2]; // bit mask for busy endpoint, only for transfer submitted by usbd_edpt_xfer()
   uint8_t ep_stall_mask[2]; // bit mask for stalled endpoint
+  uint8_t ep_isr_mask[2];   // bit mask for endpoint whose xfer callback is invoked in ISR
 
   uint8_t itf2drv[16];      // map interface number to driver (0xff is invalid)
+  uint8_t itf_alt[16];      // current alternate setting of interface
   uint8_t ep2drv[8][2];     // map endpoint to driver ( 0xff is invalid )
+
+  usbd_xfer_queue_t xfer_queue[8][2];
 }usbd_device_t;
 
-static usbd_device_t _usbd_dev = { 0 };
+static usbd_device_t _usbd_dev[TUD_OPT_RHPORT_COUNT];
+
+static inline usbd_device_t* get_dev(uint8_t rhport)
+{
+  return &_usbd_dev[usbd_rhport_idx(rhport)];
+}
 
 //--------------------------------------------------------------------+
 // Class Driver
@@ -71,6 +118,7 @@ typedef struct {
   bool (* control_request ) (uint8_t rhport, tusb_control_request_t const * request);
   bool (* control_request_complete ) (uint8_t rhport, tusb_control_request_t const * request);
   bool (* xfer_cb        ) (uint8_t rhport, uint8_t ep_addr, xfer_result_t, uint32_t);
+  bool (* set_interface  ) (uint8_t rhport, uint8_t itf_num, uint8_t alt); // optional, alternate setting support
   void (* sof            ) (uint8_t rhport);
   void (* reset          ) (uint8_t);
 } usbd_class_driver_t;
@@ -85,7 +133,8 @@ static usbd_class_driver_t const usbd_class_drivers[] =
         .control_request = cdcd_control_request,
         .control_request_complete = cdcd_control_request_complete,
         .xfer_cb         = cdcd_xfer_cb,
-        .sof             = NULL,
+        .set_interface   = NULL,
+        .sof             = cdcd_sof,
         .reset           = cdcd_reset
     },
   #endif
@@ -98,6 +147,7 @@ static usbd_class_driver_t const usbd_class_drivers[] =
         .control_request = mscd_control_request,
         .control_request_complete = mscd_control_request_complete,
         .xfer_cb         = mscd_xfer_cb,
+        .set_interface   = NULL,
         .sof             = NULL,
         .reset           = mscd_reset
     },
@@ -111,6 +161,7 @@ static usbd_class_driver_t const usbd_class_drivers[] =
         .control_request = hidd_control_request,
         .control_request_complete = hidd_control_request_complete,
         .xfer_cb         = hidd_xfer_cb,
+        .set_interface   = NULL,
         .sof             = NULL,
         .reset           = hidd_reset
     },
@@ -124,6 +175,7 @@ static usbd_class_driver_t const usbd_class_drivers[] =
         .control_request = midid_control_request,
         .control_request_complete = midid_control_request_complete,
         .xfer_cb         = midid_xfer_cb,
+        .set_interface   = NULL,
         .sof             = NULL,
         .reset           = midid_reset
     },
@@ -137,6 +189,7 @@ static usbd_class_driver_t const usbd_class_drivers[] =
         .control_request = cusd_control_request,
         .control_request_complete = cusd_control_request_complete,
         .xfer_cb         = cusd_xfer_cb,
+        .set_interface   = cusd_set_interface,
         .sof             = NULL,
         .reset           = cusd_reset
     },
@@ -145,75 +198,366 @@ static usbd_class_driver_t const usbd_class_drivers[] =
 
 enum { USBD_CLASS_DRIVER_COUNT = TU_ARRAY_SZIE(usbd_class_drivers) };
 
+TU_VERIFY_STATIC(USBD_CLASS_DRIVER_COUNT <= 8, "sof_consumer bit mask is too small");
+
 //--------------------------------------------------------------------+
 // DCD Event
 //--------------------------------------------------------------------+
 
-// Event queue
+// Event queue, shared by all device ports so that a single tud_task() can block on it with any RTOS.
+// Events carry their rhport and are routed to the port's device state.
 // OPT_MODE_DEVICE is used by OS NONE for mutex (disable usb isr)
 OSAL_QUEUE_DEF(OPT_MODE_DEVICE, _usbd_qdef, CFG_TUD_TASK_QUEUE_SZ, dcd_event_t);
 static osal_queue_t _usbd_q;
 
+// High priority lane: SETUP and control endpoint events are serviced before any event in _usbd_q
+// so that they are neither delayed nor dropped by a backlog of transfer complete events.
+// Only dcd isr of its port writes to it, therefore it is a lock-free typed fifo per port.
+TU_FIFO_TYPED_DEF(_usbd_hp_ff0, CFG_TUD_TASK_QUEUE_HP_SZ, dcd_event_t);
+#if TUD_OPT_RHPORT_COUNT > 1
+TU_FIFO_TYPED_DEF(_usbd_hp_ff1, CFG_TUD_TASK_QUEUE_HP_SZ, dcd_event_t);
+#endif
+
+static inline bool hp_write(uint8_t rhport, dcd_event_t const* event)
+{
+#if TUD_OPT_RHPORT_COUNT > 1
+  if ( usbd_rhport_idx(rhport) ) return _usbd_hp_ff1_write(event);
+#else
+  (void) rhport;
+#endif
+  return _usbd_hp_ff0_write(event);
+}
+
+static inline bool hp_read(dcd_event_t* event)
+{
+#if TUD_OPT_RHPORT_COUNT > 1
+  return _usbd_hp_ff0_read(event) || _usbd_hp_ff1_read(event);
+#else
+  return _usbd_hp_ff0_read(event);
+#endif
+}
+
+static inline void hp_clear(void)
+{
+  _usbd_hp_ff0_clear();
+#if TUD_OPT_RHPORT_COUNT > 1
+  _usbd_hp_ff1_clear();
+#endif
+}
+
+// Bus reset and unplug are not queued but latched per port by isr, so that they are never dropped nor
+// fall behind the events following them. Several of them before tud_task() runs collapse into one.
+typedef struct {
+  volatile uint8_t gen;    // bus reset generation, incremented on every reset/unplug and stamped on queued events
+  volatile uint8_t speed;  // speed of latched bus reset
+  volatile bool    reset;  // bus reset is latched
+  volatile bool    unplug; // unplug is latched
+} usbd_bus_state_t;
+
+static usbd_bus_state_t _usbd_bus[TUD_OPT_RHPORT_COUNT];
+
+static inline bool bus_event_pending(void)
+{
+  for (uint8_t i = 0; i < TUD_OPT_RHPORT_COUNT; i++)
+  {
+    if ( _usbd_bus[i].reset || _usbd_bus[i].unplug ) return true;
+  }
+  return false;
+}
+
+// Number of events dropped since both lanes were full
+static volatile uint32_t _usbd_dropped_count = 0;
+
+// Class driver callback is being invoked by dcd isr (fast path)
+static volatile bool _usbd_isr_dispatching = false;
+
+// Mask usb interrupt while updating state shared with dcd isr. Nothing to do for the callback
+// dispatched by isr: interrupt can't preempt itself, and enabling it there would allow nesting.
+static inline void usbd_int_lock(uint8_t rhport)
+{
+  if ( !_usbd_isr_dispatching ) dcd_int_disable(rhport);
+}
+
+static inline void usbd_int_unlock(uint8_t rhport)
+{
+  if ( !_usbd_isr_dispatching ) dcd_int_enable(rhport);
+}
+
+//--------------------------------------------------------------------+
+// Statistics
+//--------------------------------------------------------------------+
+#if CFG_TUD_STATS
+typedef struct {
+  tud_edpt_stats_t stats;
+
+  uint32_t xfer_start; // time when current transfer is started
+  uint16_t xfer_len;   // requested length of current transfer, 0 if unknown
+} usbd_edpt_stats_t;
+
+// Not cleared by bus reset
+static usbd_edpt_stats_t _usbd_stats[TUD_OPT_RHPORT_COUNT][8][2];
+
+static inline uint32_t stats_time_us(void)
+{
+  return tud_time_us_cb ? tud_time_us_cb() : 0;
+}
+#endif
+
+static inline void stats_xfer_start(uint8_t rhport, uint8_t ep_addr, uint16_t total_bytes)
+{
+#if CFG_TUD_STATS
+  usbd_edpt_stats_t* p_stats = &_usbd_stats[usbd_rhport_idx(rhport)][tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+  p_stats->xfer_start = stats_time_us();
+  p_stats->xfer_len   = total_bytes;
+#else
+  (void) rhport; (void) ep_addr; (void) total_bytes;
+#endif
+}
+
+static inline void stats_xfer_complete(uint8_t rhport, uint8_t ep_addr, uint32_t xferred_bytes)
+{
+#if CFG_TUD_STATS
+  usbd_edpt_stats_t* p_stats = &_usbd_stats[usbd_rhport_idx(rhport)][tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+
+  p_stats->stats.bytes += xferred_bytes;
+  p_stats->stats.xfer_count++;
+
+  // only transfers submitted by usbd_edpt_xfer() have known length and start time
+  if ( p_stats->xfer_len )
+  {
+    if ( xferred_bytes < p_stats->xfer_len ) p_stats->stats.short_count++;
+
+    uint32_t const inflight = stats_time_us() - p_stats->xfer_start;
+    if ( inflight > p_stats->stats.inflight_max_us ) p_stats->stats.inflight_max_us = inflight;
+
+    p_stats->xfer_len = 0;
+  }
+#else
+  (void) rhport; (void) ep_addr; (void) xferred_bytes;
+#endif
+}
+
+static inline void stats_queue_level(uint8_t rhport, uint8_t ep_addr, uint8_t count)
+{
+#if CFG_TUD_STATS
+  tud_edpt_stats_t* p_stats = &_usbd_stats[usbd_rhport_idx(rhport)][tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)].stats;
+  if ( count > p_stats->queue_max ) p_stats->queue_max = count;
+#else
+  (void) rhport; (void) ep_addr; (void) count;
+#endif
+}
+
+#if CFG_TUD_STATS
+bool tud_n_stats_get(uint8_t rhport, uint8_t ep_addr, tud_edpt_stats_t* stats)
+{
+  TU_VERIFY(tu_edpt_number(ep_addr) < 8);
+  (*stats) = _usbd_stats[usbd_rhport_idx(rhport)][tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)].stats;
+  return true;
+}
+
+void tud_n_stats_reset(uint8_t rhport)
+{
+  for(uint8_t epnum=0; epnum<8; epnum++)
+  {
+    for(uint8_t dir=0; dir<2; dir++) tu_varclr(&_usbd_stats[usbd_rhport_idx(rhport)][epnum][dir].stats);
+  }
+}
+#endif
+
+#if CFG_TUD_TRACE
+static uint8_t _usbd_trace_buf[CFG_TUD_TRACE_BUFSIZE];
+
+void usbd_trace_init(void)
+{
+  SEGGER_RTT_ConfigUpBuffer(CFG_TUD_TRACE_RTT_CHANNEL, "tusb_trace", _usbd_trace_buf, sizeof(_usbd_trace_buf), SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+}
+#endif
+
 //--------------------------------------------------------------------+
 // Prototypes
 //--------------------------------------------------------------------+
 static void mark_interface_endpoint(uint8_t ep2drv[8][2], uint8_t const* p_desc, uint16_t desc_len, uint8_t driver_id);
+static uint16_t itf_desc_len(uint8_t const* p_desc, uint8_t const* desc_end);
 static bool process_control_request(uint8_t rhport, tusb_control_request_t const * p_request);
 static bool process_set_config(uint8_t rhport, uint8_t cfg_num);
 static bool process_get_descriptor(uint8_t rhport, tusb_control_request_t const * p_request);
+static void process_event(dcd_event_t const * event);
+static void process_hp_events(void);
+static void process_bus_events(uint8_t rhport);
+static void edpt_xfer_next(uint8_t rhport, uint8_t ep_addr);
 
 void usbd_control_reset (uint8_t rhport);
 bool usbd_control_xfer_cb (uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes);
-void usbd_control_set_complete_callback( bool (*fp) (uint8_t, tusb_control_request_t const * ) );
+void usbd_control_set_complete_callback(uint8_t rhport, bool (*fp) (uint8_t, tusb_control_request_t const * ) );
+void usbd_control_set_request(uint8_t rhport, tusb_control_request_t const * request);
+
+//--------------------------------------------------------------------+
+// Descriptor callbacks, asked per roothub port if there are more than one device port
+//--------------------------------------------------------------------+
+static inline uint8_t const* get_desc_device(uint8_t rhport)
+{
+#if TUD_OPT_RHPORT_COUNT > 1
+  return tud_n_descriptor_device_cb(rhport);
+#else
+  (void) rhport;
+  return tud_descriptor_device_cb();
+#endif
+}
+
+static inline uint8_t const* get_desc_configuration(uint8_t rhport, uint8_t index)
+{
+#if TUD_OPT_RHPORT_COUNT > 1
+  return tud_n_descriptor_configuration_cb(rhport, index);
+#else
+  (void) rhport;
+  return tud_descriptor_configuration_cb(index);
+#endif
+}
+
+static inline uint16_t const* get_desc_string(uint8_t rhport, uint8_t index)
+{
+#if TUD_OPT_RHPORT_COUNT > 1
+  return tud_n_descriptor_string_cb(rhport, index);
+#else
+  (void) rhport;
+  return tud_descriptor_string_cb(index);
+#endif
+}
+
+// Optional callbacks, return NULL if not implemented by application
+static inline uint8_t const* get_desc_device_qualifier(uint8_t rhport)
+{
+#if TUD_OPT_RHPORT_COUNT > 1
+  return tud_n_descriptor_device_qualifier_cb ? tud_n_descriptor_device_qualifier_cb(rhport) : NULL;
+#else
+  (void) rhport;
+  return tud_descriptor_device_qualifier_cb ? tud_descriptor_device_qualifier_cb() : NULL;
+#endif
+}
+
+static inline uint8_t const* get_desc_other_speed_configuration(uint8_t rhport, uint8_t index)
+{
+#if TUD_OPT_RHPORT_COUNT > 1
+  return tud_n_descriptor_other_speed_configuration_cb ? tud_n_descriptor_other_speed_configuration_cb(rhport, index) : NULL;
+#else
+  (void) rhport;
+  return tud_descriptor_other_speed_configuration_cb ? tud_descriptor_other_speed_configuration_cb(index) : NULL;
+#endif
+}
+
+static inline uint8_t const* get_desc_bos(uint8_t rhport)
+{
+#if TUD_OPT_RHPORT_COUNT > 1
+  return tud_n_descriptor_bos_cb ? tud_n_descriptor_bos_cb(rhport) : NULL;
+#else
+  (void) rhport;
+  return tud_descriptor_bos_cb ? tud_descriptor_bos_cb() : NULL;
+#endif
+}
+
+// Check if roothub port is configured as high speed capable
+static inline bool is_high_speed_capable(uint8_t rhport)
+{
+  return TUD_OPT_HIGH_SPEED_N(rhport) != 0;
+}
 
 //--------------------------------------------------------------------+
 // Application API
 //--------------------------------------------------------------------+
-bool tud_mounted(void)
+// rhport may come from a class instance that is not opened yet
+static inline bool is_device_rhport(uint8_t rhport)
+{
+  return usbd_rhport_idx(rhport) < TUD_OPT_RHPORT_COUNT;
+}
+
+bool tud_n_mounted(uint8_t rhport)
+{
+  return is_device_rhport(rhport) && get_dev(rhport)->configured;
+}
+
+bool tud_n_suspended(uint8_t rhport)
 {
-  return _usbd_dev.configured;
+  return is_device_rhport(rhport) && get_dev(rhport)->suspended;
 }
 
-bool tud_suspended(void)
+tusb_speed_t tud_n_speed_get(uint8_t rhport)
 {
-  return _usbd_dev.suspended;
+  return is_device_rhport(rhport) ? (tusb_speed_t) get_dev(rhport)->speed : TUSB_SPEED_FULL;
 }
 
-bool tud_remote_wakeup(void)
+bool tud_n_remote_wakeup(uint8_t rhport)
 {
-  // only wake up host if this feature is supported and enabled and we are suspended
-  TU_VERIFY (_usbd_dev.suspended && _usbd_dev.remote_wakeup_support && _usbd_dev.remote_wakeup_en );
-  dcd_remote_wakeup(TUD_OPT_RHPORT);
+  TU_VERIFY( is_device_rhport(rhport) );
+  usbd_device_t* p_dev = get_dev(rhport);
+
+  // only wake up host if this feature is supported and enabled and we are suspended.
+  // For L1 sleep, remote wakeup is permitted by bRemoteWake of the LPM token instead.
+  if ( p_dev->lpm_sleep )
+  {
+    TU_VERIFY( p_dev->lpm_remote_wakeup_en );
+  }else
+  {
+    TU_VERIFY( p_dev->suspended && p_dev->remote_wakeup_support && p_dev->remote_wakeup_en );
+  }
+
+  dcd_remote_wakeup(rhport);
   return true;
 }
 
+uint32_t tud_event_dropped_count(void)
+{
+  return _usbd_dropped_count;
+}
+
 //--------------------------------------------------------------------+
 // USBD Task
 //--------------------------------------------------------------------+
 bool usbd_init (void)
 {
-  tu_varclr(&_usbd_dev);
+  tu_memclr(_usbd_dev, sizeof(_usbd_dev));
+  tu_memclr((void*) _usbd_bus, sizeof(_usbd_bus));
+
+  TUD_TRACE_INIT();
 
   // Init device queue & task
   _usbd_q = osal_queue_create(&_usbd_qdef);
   TU_ASSERT(_usbd_q != NULL);
+  hp_clear();
 
   // Init class drivers
   for (uint8_t i = 0; i < USBD_CLASS_DRIVER_COUNT; i++) usbd_class_drivers[i].init();
 
-  // Init device controller driver
-  dcd_init(TUD_OPT_RHPORT);
-  dcd_int_enable(TUD_OPT_RHPORT);
+  // Init device controller driver of all device roothub ports
+  for (uint8_t i = 0; i < TUD_OPT_RHPORT_COUNT; i++)
+  {
+    uint8_t const rhport = (uint8_t) (TUD_OPT_RHPORT + i);
+
+    dcd_init(rhport);
+    dcd_int_enable(rhport);
+  }
 
   return true;
 }
 
 static void usbd_reset(uint8_t rhport)
 {
-  tu_varclr(&_usbd_dev);
+  usbd_device_t* p_dev = get_dev(rhport);
+
+  // subscriptions end with bus reset
+  if ( p_dev->sof_consumer && dcd_sof_enable ) dcd_sof_enable(rhport, false);
 
-  memset(_usbd_dev.itf2drv, 0xff, sizeof(_usbd_dev.itf2drv)); // invalid mapping
-  memset(_usbd_dev.ep2drv , 0xff, sizeof(_usbd_dev.ep2drv )); // invalid mapping
+  // LPM is acknowledged again only after new host reads BOS
+  if ( dcd_lpm_enable ) dcd_lpm_enable(rhport, false);
+
+  // dcd isr reads endpoint masks and mapping
+  usbd_int_lock(rhport);
+
+  tu_varclr(p_dev);
+
+  memset(p_dev->itf2drv, 0xff, sizeof(p_dev->itf2drv)); // invalid mapping
+  memset(p_dev->ep2drv , 0xff, sizeof(p_dev->ep2drv )); // invalid mapping
+
+  usbd_int_unlock(rhport);
 
   usbd_control_reset(rhport);
 
@@ -248,87 +592,209 @@ void tud_task (void)
   if ( !tusb_inited() ) return;
 
   // Loop until there is no more events in the queue
+  while (1)
+  {
+    // High priority events always go first
+    process_hp_events();
+
+    // Drain a batch of events at once to save queue locking/kernel call per event
+    dcd_event_t events[CFG_TUD_TASK_EVENT_BATCH];
+
+    uint16_t const count = osal_queue_receive_n(_usbd_q, events, CFG_TUD_TASK_EVENT_BATCH);
+    if ( count == 0 ) return;
+
+    for(uint16_t i=0; i<count; i++)
+    {
+      process_event(&events[i]);
+
+      // high priority events arrived meanwhile must not wait for the rest of the batch
+      process_hp_events();
+    }
+  }
+}
+
+/* Budgeted variant of tud_task() for firmware with its own deadlines.
+ * Process events until the queue is empty or either budget is used up, whichever comes first:
+ * - max_events: number of events to process, 0 for no limit
+ * - max_us    : time in microseconds measured by tud_time_us_cb(), 0 for no limit.
+ *               Ignored if application does not implement tud_time_us_cb().
+ * Unlike tud_task() it never blocks on RTOS, and is checked after each event, so an event
+ * handler running long can still exceed max_us.
+ *
+ * @returns true if there are still events to process
+ */
+bool tud_task_ext(uint32_t max_events, uint32_t max_us)
+{
+  // Skip if stack is not initialized
+  if ( !tusb_inited() ) return false;
+
+  bool const timed = (max_us > 0) && (tud_time_us_cb != NULL);
+  uint32_t const start_us = timed ? tud_time_us_cb() : 0;
+  uint32_t count = 0;
+
   while (1)
   {
     dcd_event_t event;
 
-    if ( !osal_queue_receive(_usbd_q, &event) ) return;
+    for (uint8_t i = 0; i < TUD_OPT_RHPORT_COUNT; i++) process_bus_events((uint8_t) (TUD_OPT_RHPORT + i));
 
-    switch ( event.event_id )
+    // High priority events always go first, check normal queue before receiving to never block
+    if ( !hp_read(&event) )
     {
-      case DCD_EVENT_BUS_RESET:
-        usbd_reset(event.rhport);
-      break;
+      if ( bus_event_pending() ) continue;
+      if ( osal_queue_empty(_usbd_q) ) return false;
+      if ( 0 == osal_queue_receive_n(_usbd_q, &event, 1) ) return false;
+    }
+
+    process_event(&event);
+    count++;
+
+    if ( max_events && (count >= max_events) ) break;
+    if ( timed && ((tud_time_us_cb() - start_us) >= max_us) ) break;
+  }
+
+  return bus_event_pending() || !( _usbd_hp_ff0_empty() &&
+#if TUD_OPT_RHPORT_COUNT > 1
+                                   _usbd_hp_ff1_empty() &&
+#endif
+                                   osal_queue_empty(_usbd_q) );
+}
+
+// Service bus reset/unplug latched by isr
+static void process_bus_events(uint8_t rhport)
+{
+  usbd_device_t* p_dev = get_dev(rhport);
+  usbd_bus_state_t* bus = &_usbd_bus[usbd_rhport_idx(rhport)];
+
+  // Clear flag before reading its data: one latched meanwhile is serviced again by next call
+  if ( bus->unplug )
+  {
+    bus->unplug = false;
+    uint8_t const gen = bus->gen;
+
+    TUD_TRACE(TUD_TRACE_QUEUE_RECV, DCD_EVENT_UNPLUGGED, 0);
+    usbd_reset(rhport);
+    p_dev->bus_gen = gen;
+
+    // invoke callback
+    if (tud_umount_cb) tud_umount_cb();
+  }
 
-      case DCD_EVENT_UNPLUGGED:
-        usbd_reset(event.rhport);
+  if ( bus->reset )
+  {
+    bus->reset = false;
+    uint8_t const gen   = bus->gen;
+    uint8_t const speed = bus->speed;
+
+    TUD_TRACE(TUD_TRACE_QUEUE_RECV, DCD_EVENT_BUS_RESET, 0);
+    usbd_reset(rhport);
+    p_dev->speed   = speed;
+    p_dev->bus_gen = gen;
+  }
+}
+
+static void process_hp_events(void)
+{
+  for (uint8_t i = 0; i < TUD_OPT_RHPORT_COUNT; i++) process_bus_events((uint8_t) (TUD_OPT_RHPORT + i));
+
+  dcd_event_t event;
+  while ( hp_read(&event) ) process_event(&event);
+}
 
-        // invoke callback
-        if (tud_umount_cb) tud_umount_cb();
-      break;
+// Handle an event retrieved from the queue
+static void process_event(dcd_event_t const * event)
+{
+  usbd_device_t* p_dev = get_dev(event->rhport);
+
+  TUD_TRACE(TUD_TRACE_QUEUE_RECV, event->event_id, 0);
 
-      case DCD_EVENT_SETUP_RECEIVED:
-        // Mark as connected after receiving 1st setup packet.
-        // But it is easier to set it every time instead of wasting time to check then set
-        _usbd_dev.connected = 1;
+  // Deferred function calls are not bound to the bus and are always executed
+  if ( (event->event_id != USBD_EVENT_FUNC_CALL) && (event->bus_gen != p_dev->bus_gen) )
+  {
+    // Event from a newer generation: its bus reset is latched before it, service that first
+    process_bus_events(event->rhport);
 
-        // Process control request
-        if ( !process_control_request(event.rhport, &event.setup_received) )
+    // Queued before a bus reset that is already serviced: endpoints and drivers it refers to are gone.
+    if ( event->bus_gen != p_dev->bus_gen ) return;
+  }
+
+  switch ( event->event_id )
+  {
+    case DCD_EVENT_SETUP_RECEIVED:
+      // Mark as connected after receiving 1st setup packet.
+      // But it is easier to set it every time instead of wasting time to check then set
+      p_dev->connected = 1;
+
+      // Process control request
+      if ( !process_control_request(event->rhport, &event->setup_received) )
+      {
+        // Failed -> stall both control endpoint IN and OUT
+        dcd_edpt_stall(event->rhport, 0);
+        dcd_edpt_stall(event->rhport, 0 | TUSB_DIR_IN_MASK);
+      }
+    break;
+
+    case DCD_EVENT_XFER_COMPLETE:
+      // Only handle xfer callback in ready state
+      // if (p_dev->connected && !p_dev->suspended)
+      {
+        // Invoke the class callback associated with the endpoint address
+        uint8_t const ep_addr = event->xfer_complete.ep_addr;
+
+        if ( 0 == tu_edpt_number(ep_addr) )
         {
-          // Failed -> stall both control endpoint IN and OUT
-          dcd_edpt_stall(event.rhport, 0);
-          dcd_edpt_stall(event.rhport, 0 | TUSB_DIR_IN_MASK);
+          // control transfer DATA stage callback
+          usbd_control_xfer_cb(event->rhport, ep_addr, event->xfer_complete.result, event->xfer_complete.len);
         }
-      break;
-
-      case DCD_EVENT_XFER_COMPLETE:
-        // Only handle xfer callback in ready state
-        // if (_usbd_dev.connected && !_usbd_dev.suspended)
+        else
         {
-          // Invoke the class callback associated with the endpoint address
-          uint8_t const ep_addr = event.xfer_complete.ep_addr;
+          // A bus reset serviced in the high priority lane could already unmap this endpoint,
+          // skip its stale transfer complete event.
+          uint8_t const drv_id = p_dev->ep2drv[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+          TU_VERIFY(drv_id < USBD_CLASS_DRIVER_COUNT,);
+
+          TUD_TRACE(TUD_TRACE_XFER_CB_ENTER, ep_addr, event->xfer_complete.len);
+          usbd_class_drivers[drv_id].xfer_cb(event->rhport, ep_addr, event->xfer_complete.result, event->xfer_complete.len);
+          TUD_TRACE(TUD_TRACE_XFER_CB_EXIT, ep_addr, 0);
+        }
+      }
+    break;
 
-          if ( 0 == tu_edpt_number(ep_addr) )
-          {
-            // control transfer DATA stage callback
-            usbd_control_xfer_cb(event.rhport, ep_addr, event.xfer_complete.result, event.xfer_complete.len);
-          }
-          else
-          {
-            uint8_t const drv_id = _usbd_dev.ep2drv[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
-            TU_ASSERT(drv_id < USBD_CLASS_DRIVER_COUNT,);
+    case DCD_EVENT_SUSPEND:
+      if (tud_suspend_cb) tud_suspend_cb(p_dev->remote_wakeup_en);
+    break;
 
-            usbd_class_drivers[drv_id].xfer_cb(event.rhport, ep_addr, event.xfer_complete.result, event.xfer_complete.len);
-          }
-        }
-      break;
+    case DCD_EVENT_RESUME:
+      if (tud_resume_cb) tud_resume_cb();
+    break;
 
-      case DCD_EVENT_SUSPEND:
-        if (tud_suspend_cb) tud_suspend_cb(_usbd_dev.remote_wakeup_en);
-      break;
+    case DCD_EVENT_LPM_SLEEP:
+      if (tud_lpm_sleep_cb) tud_lpm_sleep_cb(event->lpm_sleep.besl, event->lpm_sleep.remote_wakeup);
+    break;
+
+    case DCD_EVENT_LPM_RESUME:
+      if (tud_lpm_resume_cb) tud_lpm_resume_cb();
+    break;
 
-      case DCD_EVENT_RESUME:
-        if (tud_resume_cb) tud_resume_cb();
-      break;
+    case DCD_EVENT_SOF:
+      p_dev->sof_pending = false;
 
-      case DCD_EVENT_SOF:
-        for ( uint8_t i = 0; i < USBD_CLASS_DRIVER_COUNT; i++ )
+      for ( uint8_t i = 0; i < USBD_CLASS_DRIVER_COUNT; i++ )
+      {
+        if ( tu_bit_test(p_dev->sof_consumer, i) && usbd_class_drivers[i].sof )
         {
-          if ( usbd_class_drivers[i].sof )
-          {
-            usbd_class_drivers[i].sof(event.rhport);
-          }
+          usbd_class_drivers[i].sof(event->rhport);
         }
-      break;
+      }
+    break;
 
-      case USBD_EVENT_FUNC_CALL:
-        if ( event.func_call.func ) event.func_call.func(event.func_call.param);
-      break;
+    case USBD_EVENT_FUNC_CALL:
+      if ( event->func_call.func ) event->func_call.func(event->func_call.param);
+    break;
 
-      default:
-        TU_BREAKPOINT();
-      break;
-    }
+    default:
+      TU_BREAKPOINT();
+    break;
   }
 }
 
@@ -340,7 +806,12 @@ void tud_task (void)
 // return false will cause its caller to stall control endpoint
 static bool process_control_request(uint8_t rhport, tusb_control_request_t const * p_request)
 {
-  usbd_control_set_complete_callback(NULL);
+  usbd_device_t* p_dev = get_dev(rhport);
+
+  TUD_TRACE(TUD_TRACE_CTRL_SETUP, p_request->bRequest, p_request->wLength);
+
+  usbd_control_set_complete_callback(rhport, NULL);
+  usbd_control_set_request(rhport, p_request);
 
   switch ( p_request->bmRequestType_bit.recipient )
   {
@@ -364,7 +835,7 @@ static bool process_control_request(uint8_t rhport, tusb_control_request_t const
 
         case TUSB_REQ_GET_CONFIGURATION:
         {
-          uint8_t cfgnum = _usbd_dev.configured ? 1 : 0;
+          uint8_t cfgnum = p_dev->configured ? 1 : 0;
           usbd_control_xfer(rhport, p_request, &cfgnum, 1);
         }
         break;
@@ -374,7 +845,8 @@ static bool process_control_request(uint8_t rhport, tusb_control_request_t const
           uint8_t const cfg_num = (uint8_t) p_request->wValue;
 
           dcd_set_config(rhport, cfg_num);
-          _usbd_dev.configured = cfg_num ? 1 : 0;
+          p_dev->configured = cfg_num ? 1 : 0;
+          p_dev->cfg_num    = cfg_num;
 
           if ( cfg_num ) TU_ASSERT( process_set_config(rhport, cfg_num) );
           usbd_control_status(rhport, p_request);
@@ -390,7 +862,7 @@ static bool process_control_request(uint8_t rhport, tusb_control_request_t const
           TU_VERIFY(TUSB_REQ_FEATURE_REMOTE_WAKEUP == p_request->wValue);
 
           // Host may enable remote wake up before suspending especially HID device
-          _usbd_dev.remote_wakeup_en = true;
+          p_dev->remote_wakeup_en = true;
           usbd_control_status(rhport, p_request);
         break;
 
@@ -399,7 +871,7 @@ static bool process_control_request(uint8_t rhport, tusb_control_request_t const
           TU_VERIFY(TUSB_REQ_FEATURE_REMOTE_WAKEUP == p_request->wValue);
 
           // Host may disable remote wake up after resuming
-          _usbd_dev.remote_wakeup_en = false;
+          p_dev->remote_wakeup_en = false;
           usbd_control_status(rhport, p_request);
         break;
 
@@ -408,7 +880,7 @@ static bool process_control_request(uint8_t rhport, tusb_control_request_t const
           // Device status bit mask
           // - Bit 0: Self Powered
           // - Bit 1: Remote Wakeup enabled
-          uint16_t status = (_usbd_dev.self_powered ? 1 : 0) | (_usbd_dev.remote_wakeup_en ? 2 : 0);
+          uint16_t status = (p_dev->self_powered ? 1 : 0) | (p_dev->remote_wakeup_en ? 2 : 0);
           usbd_control_xfer(rhport, p_request, &status, 2);
         }
         break;
@@ -422,11 +894,41 @@ static bool process_control_request(uint8_t rhport, tusb_control_request_t const
     case TUSB_REQ_RCPT_INTERFACE:
     {
       uint8_t const itf = tu_u16_low(p_request->wIndex);
-      uint8_t const drvid = _usbd_dev.itf2drv[itf];
+      TU_VERIFY(itf < TU_ARRAY_SZIE(p_dev->itf2drv));
 
+      uint8_t const drvid = p_dev->itf2drv[itf];
       TU_VERIFY(drvid < USBD_CLASS_DRIVER_COUNT);
 
-      usbd_control_set_complete_callback(usbd_class_drivers[drvid].control_request_complete );
+      // Alternate setting is managed by usbd, driver is only asked to switch its endpoints
+      if ( TUSB_REQ_TYPE_STANDARD == p_request->bmRequestType_bit.type )
+      {
+        if ( TUSB_REQ_GET_INTERFACE == p_request->bRequest )
+        {
+          return usbd_control_xfer(rhport, p_request, &p_dev->itf_alt[itf], 1);
+        }
+
+        if ( TUSB_REQ_SET_INTERFACE == p_request->bRequest )
+        {
+          uint8_t const alt = (uint8_t) p_request->wValue;
+
+          // alternate setting must exist in current configuration
+          TU_VERIFY( usbd_desc_itf_get(rhport, itf, alt) );
+
+          if ( usbd_class_drivers[drvid].set_interface )
+          {
+            TU_VERIFY( usbd_class_drivers[drvid].set_interface(rhport, itf, alt) );
+          }else
+          {
+            // driver without alternate setting support
+            TU_VERIFY( alt == 0 );
+          }
+
+          p_dev->itf_alt[itf] = alt;
+          return usbd_control_status(rhport, p_request);
+        }
+      }
+
+      usbd_control_set_complete_callback(rhport, usbd_class_drivers[drvid].control_request_complete );
 
       // stall control endpoint if driver return false
       return usbd_class_drivers[drvid].control_request(rhport, p_request);
@@ -479,12 +981,14 @@ static bool process_control_request(uint8_t rhport, tusb_control_request_t const
 // This function parse configuration descriptor & open drivers accordingly
 static bool process_set_config(uint8_t rhport, uint8_t cfg_num)
 {
-  tusb_desc_configuration_t const * desc_cfg = (tusb_desc_configuration_t const *) tud_descriptor_configuration_cb(cfg_num-1); // index is cfg_num-1
+  usbd_device_t* p_dev = get_dev(rhport);
+
+  tusb_desc_configuration_t const * desc_cfg = (tusb_desc_configuration_t const *) get_desc_configuration(rhport, cfg_num-1); // index is cfg_num-1
   TU_ASSERT(desc_cfg != NULL && desc_cfg->bDescriptorType == TUSB_DESC_CONFIGURATION);
 
   // Parse configuration descriptor
-  _usbd_dev.remote_wakeup_support = (desc_cfg->bmAttributes & TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP) ? 1 : 0;
-  _usbd_dev.self_powered = (desc_cfg->bmAttributes & TUSB_DESC_CONFIG_ATT_SELF_POWERED) ? 1 : 0;
+  p_dev->remote_wakeup_support = (desc_cfg->bmAttributes & TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP) ? 1 : 0;
+  p_dev->self_powered = (desc_cfg->bmAttributes & TUSB_DESC_CONFIG_ATT_SELF_POWERED) ? 1 : 0;
 
   // Parse interface descriptor
   uint8_t const * p_desc   = ((uint8_t const*) desc_cfg) + sizeof(tusb_desc_configuration_t);
@@ -496,6 +1000,20 @@ static bool process_set_config(uint8_t rhport, uint8_t cfg_num)
     if ( TUSB_DESC_INTERFACE_ASSOCIATION == tu_desc_type(p_desc) )
     {
       p_desc = tu_desc_next(p_desc); // ignore Interface Association
+    }else if ( (TUSB_DESC_INTERFACE == tu_desc_type(p_desc)) && ((tusb_desc_interface_t const*) p_desc)->bAlternateSetting )
+    {
+      // Alternate setting (not consumed by driver's open) of an opened interface. Its endpoints belong to
+      // the same driver, which opens them when host selects this setting with SET_INTERFACE.
+      tusb_desc_interface_t const* desc_itf = (tusb_desc_interface_t const*) p_desc;
+      TU_ASSERT( desc_itf->bInterfaceNumber < TU_ARRAY_SZIE(p_dev->itf2drv) );
+
+      uint8_t const drv_id = p_dev->itf2drv[desc_itf->bInterfaceNumber];
+      TU_ASSERT( drv_id < USBD_CLASS_DRIVER_COUNT );
+
+      uint16_t const alt_len = itf_desc_len(p_desc, desc_end);
+      mark_interface_endpoint(p_dev->ep2drv, p_desc, alt_len, drv_id);
+
+      p_desc += alt_len;
     }else
     {
       TU_ASSERT( TUSB_DESC_INTERFACE == tu_desc_type(p_desc) );
@@ -510,15 +1028,16 @@ static bool process_set_config(uint8_t rhport, uint8_t cfg_num)
       }
       TU_ASSERT( drv_id < USBD_CLASS_DRIVER_COUNT );
 
-      // Interface number must not be used already TODO alternate interface
-      TU_ASSERT( 0xff == _usbd_dev.itf2drv[desc_itf->bInterfaceNumber] );
-      _usbd_dev.itf2drv[desc_itf->bInterfaceNumber] = drv_id;
+      // Interface number must not be used already
+      TU_ASSERT( desc_itf->bInterfaceNumber < TU_ARRAY_SZIE(p_dev->itf2drv) );
+      TU_ASSERT( 0xff == p_dev->itf2drv[desc_itf->bInterfaceNumber] );
+      p_dev->itf2drv[desc_itf->bInterfaceNumber] = drv_id;
 
       uint16_t itf_len=0;
       TU_ASSERT( usbd_class_drivers[drv_id].open( rhport, desc_itf, &itf_len ) );
       TU_ASSERT( itf_len >= sizeof(tusb_desc_interface_t) );
 
-      mark_interface_endpoint(_usbd_dev.ep2drv, p_desc, itf_len, drv_id);
+      mark_interface_endpoint(p_dev->ep2drv, p_desc, itf_len, drv_id);
 
       p_desc += itf_len; // next interface
     }
@@ -530,6 +1049,20 @@ static bool process_set_config(uint8_t rhport, uint8_t cfg_num)
   return true;
 }
 
+// Length of an interface (setting) descriptor including its class specific and endpoint descriptors
+static uint16_t itf_desc_len(uint8_t const* p_desc, uint8_t const* desc_end)
+{
+  uint8_t const* p_next = tu_desc_next(p_desc);
+
+  while ( (p_next < desc_end) && (TUSB_DESC_INTERFACE != tu_desc_type(p_next)) &&
+          (TUSB_DESC_INTERFACE_ASSOCIATION != tu_desc_type(p_next)) )
+  {
+    p_next = tu_desc_next(p_next);
+  }
+
+  return (uint16_t) (p_next - p_desc);
+}
+
 // Helper marking endpoint of interface belongs to class driver
 static void mark_interface_endpoint(uint8_t ep2drv[8][2], uint8_t const* p_desc, uint16_t desc_len, uint8_t driver_id)
 {
@@ -549,6 +1082,28 @@ static void mark_interface_endpoint(uint8_t ep2drv[8][2], uint8_t const* p_desc,
   }
 }
 
+// Check if USB 2.0 Extension capability of BOS descriptor has LPM attribute
+static bool bos_lpm_supported(tusb_desc_bos_t const* desc_bos)
+{
+  uint8_t const* p_desc   = (uint8_t const*) desc_bos;
+  uint8_t const* desc_end = p_desc + desc_bos->wTotalLength;
+
+  p_desc = tu_desc_next(p_desc);
+
+  while( p_desc < desc_end )
+  {
+    if ( (TUSB_DESC_DEVICE_CAPABILITY == tu_desc_type(p_desc)) && (DEVICE_CAPABILITY_USB20_EXTENSION == p_desc[2]) )
+    {
+      tusb_desc_usb20_ext_t const* desc_ext = (tusb_desc_usb20_ext_t const*) p_desc;
+      return (desc_ext->bmAttributes & TUSB_USB20_EXT_ATT_LPM) ? true : false;
+    }
+
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  return false;
+}
+
 // return descriptor's buffer and update desc_len
 static bool process_get_descriptor(uint8_t rhport, tusb_control_request_t const * p_request)
 {
@@ -558,12 +1113,25 @@ static bool process_get_descriptor(uint8_t rhport, tusb_control_request_t const
   switch(desc_type)
   {
     case TUSB_DESC_DEVICE:
-      return usbd_control_xfer(rhport, p_request, (void*) tud_descriptor_device_cb(), sizeof(tusb_desc_device_t));
+      return usbd_control_xfer(rhport, p_request, (void*) get_desc_device(rhport), sizeof(tusb_desc_device_t));
     break;
 
     case TUSB_DESC_CONFIGURATION:
     {
-      tusb_desc_configuration_t const* desc_config = (tusb_desc_configuration_t const*) tud_descriptor_configuration_cb(desc_index);
+      tusb_desc_configuration_t const* desc_config = (tusb_desc_configuration_t const*) get_desc_configuration(rhport, desc_index);
+      return usbd_control_xfer(rhport, p_request, (void*) desc_config, desc_config->wTotalLength);
+    }
+    break;
+
+    case TUSB_DESC_OTHER_SPEED_CONFIG:
+    {
+      // full speed only device must stall this request (USB 2.0 section 9.6.2)
+      TU_VERIFY( is_high_speed_capable(rhport) );
+
+      tusb_desc_configuration_t const* desc_config = (tusb_desc_configuration_t const*) get_desc_other_speed_configuration(rhport, desc_index);
+      TU_VERIFY(desc_config);
+      TU_ASSERT(desc_config->bDescriptorType == TUSB_DESC_OTHER_SPEED_CONFIG);
+
       return usbd_control_xfer(rhport, p_request, (void*) desc_config, desc_config->wTotalLength);
     }
     break;
@@ -577,7 +1145,7 @@ static bool process_get_descriptor(uint8_t rhport, tusb_control_request_t const
         return false;
       }else
       {
-        uint8_t const* desc_str = (uint8_t const*) tud_descriptor_string_cb(desc_index);
+        uint8_t const* desc_str = (uint8_t const*) get_desc_string(rhport, desc_index);
         TU_ASSERT(desc_str);
 
         // first byte of descriptor is its size
@@ -585,10 +1153,29 @@ static bool process_get_descriptor(uint8_t rhport, tusb_control_request_t const
       }
     break;
 
+    case TUSB_DESC_BOS:
+    {
+      tusb_desc_bos_t const* desc_bos = (tusb_desc_bos_t const*) get_desc_bos(rhport);
+      TU_VERIFY(desc_bos);
+      TU_ASSERT(desc_bos->bDescriptorType == TUSB_DESC_BOS);
+
+      // Host only issues LPM transaction after learning from BOS that device supports it
+      if ( dcd_lpm_enable ) dcd_lpm_enable(rhport, bos_lpm_supported(desc_bos));
+
+      return usbd_control_xfer(rhport, p_request, (void*) desc_bos, desc_bos->wTotalLength);
+    }
+    break;
+
     case TUSB_DESC_DEVICE_QUALIFIER:
-      // TODO If not highspeed capable stall this request otherwise
-      // return the descriptor that could work in highspeed
-      return false;
+    {
+      // full speed only device must stall this request (USB 2.0 section 9.6.2)
+      TU_VERIFY( is_high_speed_capable(rhport) );
+
+      uint8_t const* desc_qualifier = get_desc_device_qualifier(rhport);
+      TU_VERIFY(desc_qualifier);
+
+      return usbd_control_xfer(rhport, p_request, (void*) desc_qualifier, sizeof(tusb_desc_device_qualifier_t));
+    }
     break;
 
     default: return false;
@@ -600,59 +1187,213 @@ static bool process_get_descriptor(uint8_t rhport, tusb_control_request_t const
 //--------------------------------------------------------------------+
 // DCD Event Handler
 //--------------------------------------------------------------------+
+
+// Start the next queued transfer of endpoint or mark it as idle, called on transfer complete
+static void edpt_xfer_next(uint8_t rhport, uint8_t ep_addr)
+{
+  usbd_device_t* p_dev = get_dev(rhport);
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir   = tu_edpt_dir(ep_addr);
+
+  usbd_xfer_queue_t* xq = &p_dev->xfer_queue[epnum][dir];
+
+  if ( xq->count == 0 )
+  {
+    p_dev->ep_busy_mask[dir] = (uint8_t) tu_bit_clear(p_dev->ep_busy_mask[dir], epnum);
+    return;
+  }
+
+  uint8_t* const buffer      = xq->xfer[xq->rd_idx].buffer;
+  uint16_t const total_bytes = xq->xfer[xq->rd_idx].total_bytes;
+
+  xq->rd_idx = (uint8_t) ((xq->rd_idx + 1) % CFG_TUD_EDPT_XFER_QUEUE_SZ);
+  xq->count--;
+
+  stats_xfer_start(rhport, ep_addr, total_bytes);
+
+  TU_ASSERT( dcd_edpt_xfer(rhport, ep_addr, buffer, total_bytes), );
+}
+
+// Queue event to the normal lane, keep track of dropped one
+static bool queue_event(dcd_event_t const * event, bool in_isr)
+{
+  dcd_event_t stamped = *event;
+  stamped.bus_gen = _usbd_bus[usbd_rhport_idx(event->rhport)].gen;
+
+  bool const queued = osal_queue_send(_usbd_q, &stamped, in_isr);
+  TUD_TRACE(TUD_TRACE_QUEUE_SEND, event->event_id, queued);
+
+  if ( !queued ) _usbd_dropped_count++;
+
+  return queued;
+}
+
+// Wake up tud_task() blocked on the normal lane with an empty function call, after an event is passed
+// outside of it. Nothing is lost if this fails since the queue is not empty and tud_task() will check
+// the high priority lane and bus state before the next event anyway.
+static inline void wakeup_task(uint8_t rhport, bool in_isr)
+{
+#if CFG_TUSB_OS != OPT_OS_NONE
+  dcd_event_t const wakeup = { .rhport = rhport, .event_id = USBD_EVENT_FUNC_CALL };
+  (void) osal_queue_send(_usbd_q, &wakeup, in_isr);
+#else
+  (void) rhport;
+  (void) in_isr;
+#endif
+}
+
+// Queue event to the high priority lane, fall back to the normal lane if it is full
+static void queue_event_hp(dcd_event_t const * event, bool in_isr)
+{
+  dcd_event_t stamped = *event;
+  stamped.bus_gen = _usbd_bus[usbd_rhport_idx(event->rhport)].gen;
+
+  if ( !hp_write(event->rhport, &stamped) )
+  {
+    queue_event(event, in_isr);
+    return;
+  }
+
+  TUD_TRACE(TUD_TRACE_QUEUE_SEND, event->event_id, 1);
+  wakeup_task(event->rhport, in_isr);
+}
+
+// Latch bus reset/unplug, events queued from now on belong to the new generation
+static void latch_bus_event(dcd_event_t const * event, bool in_isr)
+{
+  usbd_bus_state_t* bus = &_usbd_bus[usbd_rhport_idx(event->rhport)];
+
+  bus->gen++;
+
+  if ( event->event_id == DCD_EVENT_BUS_RESET )
+  {
+    bus->speed = (uint8_t) event->bus_reset.speed;
+    bus->reset = true;
+  }else
+  {
+    // reset latched before unplug is superseded
+    bus->reset  = false;
+    bus->unplug = true;
+  }
+
+  TUD_TRACE(TUD_TRACE_QUEUE_SEND, event->event_id, 1);
+  wakeup_task(event->rhport, in_isr);
+}
+
 void dcd_event_handler(dcd_event_t const * event, bool in_isr)
 {
+  usbd_device_t* p_dev = get_dev(event->rhport);
+
+  TUD_TRACE(TUD_TRACE_DCD_EVENT, event->event_id, (event->event_id == DCD_EVENT_XFER_COMPLETE) ? event->xfer_complete.ep_addr : 0);
+
   switch (event->event_id)
   {
     case DCD_EVENT_BUS_RESET:
-      osal_queue_send(_usbd_q, event, in_isr);
+      latch_bus_event(event, in_isr);
     break;
 
     case DCD_EVENT_UNPLUGGED:
-      _usbd_dev.connected = 0;
-      _usbd_dev.configured = 0;
-      _usbd_dev.suspended = 0;
-      osal_queue_send(_usbd_q, event, in_isr);
+      p_dev->connected = 0;
+      p_dev->configured = 0;
+      p_dev->suspended = 0;
+      p_dev->lpm_sleep = 0;
+      latch_bus_event(event, in_isr);
     break;
 
     case DCD_EVENT_SOF:
-      // nothing to do now
+      // Only forwarded when there is a subscriber. At most one SOF is in the queue, a slow task
+      // just misses frames instead of flooding the queue.
+      if ( p_dev->sof_consumer && !p_dev->sof_pending )
+      {
+        p_dev->sof_pending = queue_event(event, in_isr);
+      }
     break;
 
     case DCD_EVENT_SUSPEND:
       // NOTE: When plugging/unplugging device, the D+/D- state are unstable and can accidentally meet the
       // SUSPEND condition ( Idle for 3ms ). Some MCUs such as samd don't distinguish suspend vs disconnect as well.
       // We will skip handling SUSPEND/RESUME event if not currently connected
-      if ( _usbd_dev.connected )
+      if ( p_dev->connected )
       {
-        _usbd_dev.suspended = 1;
-        osal_queue_send(_usbd_q, event, in_isr);
+        p_dev->suspended = 1;
+        queue_event(event, in_isr);
       }
     break;
 
     case DCD_EVENT_RESUME:
-      if ( _usbd_dev.connected )
+    case DCD_EVENT_LPM_RESUME:
+      if ( p_dev->connected )
+      {
+        if ( p_dev->lpm_sleep )
+        {
+          // port may not tell L1 resume apart from the suspend one
+          dcd_event_t const lpm_resume = { .rhport = event->rhport, .event_id = DCD_EVENT_LPM_RESUME };
+
+          p_dev->lpm_sleep = 0;
+          queue_event(&lpm_resume, in_isr);
+        }
+        else if ( event->event_id == DCD_EVENT_RESUME )
+        {
+          p_dev->suspended = 0;
+          queue_event(event, in_isr);
+        }
+      }
+    break;
+
+    case DCD_EVENT_LPM_SLEEP:
+      if ( p_dev->connected )
       {
-        _usbd_dev.suspended = 0;
-        osal_queue_send(_usbd_q, event, in_isr);
+        p_dev->lpm_sleep = 1;
+        p_dev->lpm_remote_wakeup_en = event->lpm_sleep.remote_wakeup ? 1 : 0;
+        queue_event(event, in_isr);
       }
     break;
 
     case DCD_EVENT_SETUP_RECEIVED:
-      osal_queue_send(_usbd_q, event, in_isr);
+      queue_event_hp(event, in_isr);
     break;
 
     case DCD_EVENT_XFER_COMPLETE:
+    {
+      uint8_t const ep_addr = event->xfer_complete.ep_addr;
+
       // skip zero-length control status complete event, should dcd notifies us.
-      if ( (0 == tu_edpt_number(event->xfer_complete.ep_addr)) && (event->xfer_complete.len == 0) ) break;
+      if ( (0 == tu_edpt_number(ep_addr)) && (event->xfer_complete.len == 0) ) break;
+
+      stats_xfer_complete(event->rhport, ep_addr, event->xfer_complete.len);
+
+      // Submit next queued transfer right away to keep the endpoint streaming
+      if ( 0 != tu_edpt_number(ep_addr) ) edpt_xfer_next(event->rhport, ep_addr);
+
+      if ( tu_bit_test(p_dev->ep_isr_mask[tu_edpt_dir(ep_addr)], tu_edpt_number(ep_addr)) )
+      {
+        // Fast path: invoke class driver right away instead of waiting for tud_task()
+        uint8_t const drv_id = p_dev->ep2drv[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+        TU_ASSERT(drv_id < USBD_CLASS_DRIVER_COUNT,);
+
+        TUD_TRACE(TUD_TRACE_XFER_CB_ENTER, ep_addr, event->xfer_complete.len);
+        _usbd_isr_dispatching = true;
+        usbd_class_drivers[drv_id].xfer_cb(event->rhport, ep_addr, (xfer_result_t) event->xfer_complete.result, event->xfer_complete.len);
+        _usbd_isr_dispatching = false;
+        TUD_TRACE(TUD_TRACE_XFER_CB_EXIT, ep_addr, 0);
+      }
+      else if ( 0 == tu_edpt_number(ep_addr) )
+      {
+        // data stage must be serviced in the same lane as the SETUP it belongs to
+        queue_event_hp(event, in_isr);
+      }
+      else
+      {
+        queue_event(event, in_isr);
+      }
 
-      osal_queue_send(_usbd_q, event, in_isr);
       TU_ASSERT(event->xfer_complete.result == XFER_RESULT_SUCCESS,);
+    }
     break;
 
     // Not an DCD event, just a convenient way to defer ISR function should we need to
     case USBD_EVENT_FUNC_CALL:
-      osal_queue_send(_usbd_q, event, in_isr);
+      queue_event(event, in_isr);
     break;
 
     default: break;
@@ -666,6 +1407,21 @@ void dcd_event_bus_signal (uint8_t rhport, dcd_eventid_t eid, bool in_isr)
   dcd_event_handler(&event, in_isr);
 }
 
+void dcd_event_bus_reset (uint8_t rhport, tusb_speed_t speed, bool in_isr)
+{
+  dcd_event_t event = { .rhport = rhport, .event_id = DCD_EVENT_BUS_RESET };
+  event.bus_reset.speed = speed;
+  dcd_event_handler(&event, in_isr);
+}
+
+void dcd_event_lpm_sleep (uint8_t rhport, uint8_t besl, bool remote_wakeup, bool in_isr)
+{
+  dcd_event_t event = { .rhport = rhport, .event_id = DCD_EVENT_LPM_SLEEP };
+  event.lpm_sleep.besl          = besl;
+  event.lpm_sleep.remote_wakeup = remote_wakeup;
+  dcd_event_handler(&event, in_isr);
+}
+
 // helper to send setup received
 void dcd_event_setup_received(uint8_t rhport, uint8_t const * setup, bool in_isr)
 {
@@ -715,19 +1471,48 @@ bool usbd_open_edpt_pair(uint8_t rhport, uint8_t const* p_desc, uint8_t ep_count
   return true;
 }
 
-// Helper to defer an isr function
-void usbd_defer_func(osal_task_func_t func, void* param, bool in_isr)
+// Get interface descriptor of an alternate setting in current configuration
+tusb_desc_interface_t const* usbd_desc_itf_get(uint8_t rhport, uint8_t itf_num, uint8_t alt)
+{
+  usbd_device_t* p_dev = get_dev(rhport);
+  TU_VERIFY(p_dev->cfg_num, NULL);
+
+  tusb_desc_configuration_t const * desc_cfg = (tusb_desc_configuration_t const *) get_desc_configuration(rhport, p_dev->cfg_num-1);
+  TU_VERIFY(desc_cfg, NULL);
+
+  uint8_t const * p_desc   = ((uint8_t const*) desc_cfg) + sizeof(tusb_desc_configuration_t);
+  uint8_t const * desc_end = ((uint8_t const*) desc_cfg) + desc_cfg->wTotalLength;
+
+  while( p_desc < desc_end )
+  {
+    tusb_desc_interface_t const* desc_itf = (tusb_desc_interface_t const*) p_desc;
+
+    if ( (TUSB_DESC_INTERFACE == tu_desc_type(p_desc)) &&
+         (desc_itf->bInterfaceNumber == itf_num) && (desc_itf->bAlternateSetting == alt) )
+    {
+      return desc_itf;
+    }
+
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  return NULL;
+}
+
+// Helper to defer an isr function, return false if event queue is full
+bool usbd_defer_func(osal_task_func_t func, void* param, bool in_isr)
 {
   dcd_event_t event =
   {
-      .rhport   = 0,
+      .rhport   = TUD_OPT_RHPORT,
       .event_id = USBD_EVENT_FUNC_CALL,
   };
 
   event.func_call.func  = func;
   event.func_call.param = param;
 
-  dcd_event_handler(&event, in_isr);
+  TUD_TRACE(TUD_TRACE_DCD_EVENT, event.event_id, 0);
+  return queue_event(&event, in_isr);
 }
 
 //--------------------------------------------------------------------+
@@ -735,30 +1520,150 @@ void usbd_defer_func(osal_task_func_t func, void* param, bool in_isr)
 //--------------------------------------------------------------------+
 void usbd_edpt_stall(uint8_t rhport, uint8_t ep_addr)
 {
+  usbd_device_t* p_dev = get_dev(rhport);
+
   uint8_t const epnum = tu_edpt_number(ep_addr);
   uint8_t const dir   = tu_edpt_dir(ep_addr);
 
   dcd_edpt_stall(rhport, ep_addr);
-  _usbd_dev.ep_stall_mask[dir] = (uint8_t) tu_bit_set(_usbd_dev.ep_stall_mask[dir], epnum);
+  p_dev->ep_stall_mask[dir] = (uint8_t) tu_bit_set(p_dev->ep_stall_mask[dir], epnum);
+
+#if CFG_TUD_STATS
+  _usbd_stats[usbd_rhport_idx(rhport)][epnum][dir].stats.stall_count++;
+#endif
+}
+
+void usbd_sof_enable(uint8_t rhport, uint8_t class_code, bool en)
+{
+  usbd_device_t* p_dev = get_dev(rhport);
+
+  uint8_t drv_id;
+  for (drv_id = 0; drv_id < USBD_CLASS_DRIVER_COUNT; drv_id++)
+  {
+    if ( usbd_class_drivers[drv_id].class_code == class_code ) break;
+  }
+  TU_ASSERT(drv_id < USBD_CLASS_DRIVER_COUNT, );
+
+  uint8_t const prev_consumer = p_dev->sof_consumer;
+  p_dev->sof_consumer = (uint8_t) (en ? tu_bit_set(prev_consumer, drv_id) : tu_bit_clear(prev_consumer, drv_id));
+
+  // SOF interrupt is only enabled while there is a subscriber
+  if ( (prev_consumer == 0) != (p_dev->sof_consumer == 0) )
+  {
+    if ( dcd_sof_enable ) dcd_sof_enable(rhport, p_dev->sof_consumer != 0);
+  }
+}
+
+void usbd_edpt_close(uint8_t rhport, uint8_t ep_addr)
+{
+  usbd_device_t* p_dev = get_dev(rhport);
+
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir   = tu_edpt_dir(ep_addr);
+
+  // Port without close support keeps endpoint enabled until it is opened again
+  if ( dcd_edpt_close ) dcd_edpt_close(rhport, ep_addr);
+
+  // Drop transfer in progress and queued ones
+  usbd_int_lock(rhport);
+
+  p_dev->ep_busy_mask[dir]  = (uint8_t) tu_bit_clear(p_dev->ep_busy_mask[dir] , epnum);
+  p_dev->ep_stall_mask[dir] = (uint8_t) tu_bit_clear(p_dev->ep_stall_mask[dir], epnum);
+  p_dev->ep_isr_mask[dir]   = (uint8_t) tu_bit_clear(p_dev->ep_isr_mask[dir]  , epnum);
+  tu_varclr(&p_dev->xfer_queue[epnum][dir]);
+
+  usbd_int_unlock(rhport);
 }
 
 void usbd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr)
 {
+  usbd_device_t* p_dev = get_dev(rhport);
+
   uint8_t const epnum = tu_edpt_number(ep_addr);
   uint8_t const dir   = tu_edpt_dir(ep_addr);
 
   dcd_edpt_clear_stall(rhport, ep_addr);
-  _usbd_dev.ep_stall_mask[dir] = (uint8_t) tu_bit_clear(_usbd_dev.ep_stall_mask[dir], epnum);
+  p_dev->ep_stall_mask[dir] = (uint8_t) tu_bit_clear(p_dev->ep_stall_mask[dir], epnum);
+}
+
+void usbd_edpt_isr_dispatch(uint8_t rhport, uint8_t ep_addr, bool enable)
+{
+  usbd_device_t* p_dev = get_dev(rhport);
+
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir   = tu_edpt_dir(ep_addr);
+
+  // control endpoint is always handled by usbd task
+  TU_ASSERT(epnum != 0,);
+
+  p_dev->ep_isr_mask[dir] = (uint8_t) (enable ? tu_bit_set(p_dev->ep_isr_mask[dir], epnum) :
+                                                   tu_bit_clear(p_dev->ep_isr_mask[dir], epnum));
+}
+
+bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t total_bytes)
+{
+  usbd_device_t* p_dev = get_dev(rhport);
+
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir   = tu_edpt_dir(ep_addr);
+
+  usbd_xfer_queue_t* xq = &p_dev->xfer_queue[epnum][dir];
+
+  // Queue state is also updated by transfer complete in dcd isr.
+  // Only hold the lock for bookkeeping since some dcd_edpt_xfer() e.g nrf5x wait on usb isr.
+  usbd_int_lock(rhport);
+
+  if ( tu_bit_test(p_dev->ep_busy_mask[dir], epnum) )
+  {
+    bool const queued = (xq->count < CFG_TUD_EDPT_XFER_QUEUE_SZ);
+
+    if ( queued )
+    {
+      uint8_t const wr_idx = (uint8_t) ((xq->rd_idx + xq->count) % CFG_TUD_EDPT_XFER_QUEUE_SZ);
+      xq->xfer[wr_idx].buffer      = buffer;
+      xq->xfer[wr_idx].total_bytes = total_bytes;
+      xq->count++;
+
+      stats_queue_level(rhport, ep_addr, xq->count);
+    }
+
+    usbd_int_unlock(rhport);
+    return queued;
+  }
+
+  p_dev->ep_busy_mask[dir] = (uint8_t) tu_bit_set(p_dev->ep_busy_mask[dir], epnum);
+  usbd_int_unlock(rhport);
+
+  stats_xfer_start(rhport, ep_addr, total_bytes);
+
+  if ( !dcd_edpt_xfer(rhport, ep_addr, buffer, total_bytes) )
+  {
+    p_dev->ep_busy_mask[dir] = (uint8_t) tu_bit_clear(p_dev->ep_busy_mask[dir], epnum);
+    TU_BREAKPOINT();
+    return false;
+  }
+
+  return true;
+}
+
+bool usbd_edpt_busy(uint8_t rhport, uint8_t ep_addr)
+{
+  usbd_device_t* p_dev = get_dev(rhport);
+
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir   = tu_edpt_dir(ep_addr);
+
+  return tu_bit_test(p_dev->ep_busy_mask[dir], epnum);
 }
 
 bool usbd_edpt_stalled(uint8_t rhport, uint8_t ep_addr)
 {
-  (void) rhport;
+  usbd_device_t* p_dev = get_dev(rhport);
 
   uint8_t const epnum = tu_edpt_number(ep_addr);
   uint8_t const dir   = tu_edpt_dir(ep_addr);
 
-  return tu_bit_test(_usbd_dev.ep_stall_mask[dir], epnum);
+  return tu_bit_test(p_dev->ep_stall_mask[dir], epnum);
 }
 
 #endif
@@ -44,20 +44,105 @@
 // Task function should be called in main/rtos loop
 void tud_task (void);
 
-// Check if device is connected and configured
-bool tud_mounted(void);
+// Task function with a budget of events and/or microseconds (0 is unlimited), never blocks.
+// Return true if there are still events to process
+bool tud_task_ext(uint32_t max_events, uint32_t max_us);
 
-// Check if device is suspended
-bool tud_suspended(void);
+// Check if device on roothub port is connected and configured
+bool tud_n_mounted(uint8_t rhport);
+
+// Check if device on roothub port is suspended
+bool tud_n_suspended(uint8_t rhport);
+
+// Check if device on roothub port is ready to transfer
+static inline bool tud_n_ready(uint8_t rhport)
+{
+  return tud_n_mounted(rhport) && !tud_n_suspended(rhport);
+}
+
+// Remote wake up host, only if suspended (or in LPM L1 sleep) and enabled by host
+bool tud_n_remote_wakeup(uint8_t rhport);
+
+// Get speed negotiated with host by last bus reset
+tusb_speed_t tud_n_speed_get(uint8_t rhport);
+
+// Same as above for the (first) device roothub port TUD_OPT_RHPORT
+static inline bool tud_mounted(void)
+{
+  return tud_n_mounted(TUD_OPT_RHPORT);
+}
+
+static inline bool tud_suspended(void)
+{
+  return tud_n_suspended(TUD_OPT_RHPORT);
+}
 
-// Check if device is ready to transfer
 static inline bool tud_ready(void)
 {
-  return tud_mounted() && !tud_suspended();
+  return tud_n_ready(TUD_OPT_RHPORT);
+}
+
+static inline bool tud_remote_wakeup(void)
+{
+  return tud_n_remote_wakeup(TUD_OPT_RHPORT);
+}
+
+static inline tusb_speed_t tud_speed_get(void)
+{
+  return tud_n_speed_get(TUD_OPT_RHPORT);
 }
 
-// Remote wake up host, only if suspended and enabled by host
-bool tud_remote_wakeup(void);
+// Number of device events dropped because the event queue was full
+uint32_t tud_event_dropped_count(void);
+
+// Per-endpoint statistics maintained by the stack, disabled by default
+#ifndef CFG_TUD_STATS
+#define CFG_TUD_STATS  0
+#endif
+
+#if CFG_TUD_STATS
+typedef struct
+{
+  uint32_t bytes;           // total transferred bytes
+  uint32_t xfer_count;      // completed transfers
+  uint32_t stall_count;     // number of times endpoint is stalled
+  uint32_t short_count;     // transfers completed with less than requested bytes (short packet)
+  uint32_t inflight_max_us; // longest time between submitting and completing a transfer, need tud_time_us_cb()
+  uint8_t  queue_max;       // high water mark of endpoint's transfer queue
+} tud_edpt_stats_t;
+
+// Get statistics of an endpoint
+bool tud_n_stats_get(uint8_t rhport, uint8_t ep_addr, tud_edpt_stats_t* stats);
+
+// Clear statistics of all endpoints
+void tud_n_stats_reset(uint8_t rhport);
+
+static inline bool tud_stats_get(uint8_t ep_addr, tud_edpt_stats_t* stats)
+{
+  return tud_n_stats_get(TUD_OPT_RHPORT, ep_addr, stats);
+}
+
+static inline void tud_stats_reset(void)
+{
+  tud_n_stats_reset(TUD_OPT_RHPORT);
+}
+#endif
+
+// Control request callback can return TUD_CONTROL_PENDING to answer later, host is NAKed meanwhile.
+// Class driver does the same by returning true without starting data or status stage.
+#define TUD_CONTROL_PENDING   0xffff
+
+// Token of the control request being handled. Must be taken in the callback that returns TUD_CONTROL_PENDING,
+// and passed to tud_control_reply()/tud_control_stall() so that the answer can't be taken for a later request.
+uint8_t tud_control_token(uint8_t rhport);
+
+// Answer pending control request with data (len > 0) or status only (len = 0). Can be called in any context,
+// the reply is carried out by tud_task(). Buffer must exist until transfer is complete.
+// Only the first reply/stall of a request is accepted, it is discarded if a new SETUP or bus reset comes first.
+bool tud_control_reply(uint8_t rhport, uint8_t token, void* buffer, uint16_t len, bool in_isr);
+
+// Stall pending control request, can be called in any context
+bool tud_control_stall(uint8_t rhport, uint8_t token, bool in_isr);
 
 //--------------------------------------------------------------------+
 // Application Callbacks (WEAK is optional)
@@ -69,12 +154,38 @@ uint8_t const * tud_descriptor_device_cb(void);
 
 // Invoked when received GET CONFIGURATION DESCRIPTOR request
 // Application return pointer to descriptor, whose contents must exist long enough for transfer to complete
+// High speed capable device return the configuration for current speed, see tud_speed_get()
 uint8_t const * tud_descriptor_configuration_cb(uint8_t index);
 
 // Invoked when received GET STRING DESCRIPTOR request
 // Application return pointer to descriptor, whose contents must exist long enough for transfer to complete
 uint16_t const* tud_descriptor_string_cb(uint8_t index);
 
+// Invoked when received GET DEVICE QUALIFIER DESCRIPTOR request, only on high speed capable port.
+// Application return pointer to descriptor, which describes device when running at the other speed.
+ATTR_WEAK uint8_t const * tud_descriptor_device_qualifier_cb(void);
+
+// Invoked when received GET OTHER SPEED CONFIGURATION DESCRIPTOR request, only on high speed capable port.
+// Application return pointer to configuration of the speed that is not currently used, whose
+// bDescriptorType must be TUSB_DESC_OTHER_SPEED_CONFIG
+ATTR_WEAK uint8_t const * tud_descriptor_other_speed_configuration_cb(uint8_t index);
+
+// Invoked when received GET BOS DESCRIPTOR request, device descriptor's bcdUSB must be at least 0x0201.
+// Application return pointer to descriptor. Link Power Management is enabled on port that supports it
+// if the USB 2.0 Extension capability has TUSB_USB20_EXT_ATT_LPM set.
+ATTR_WEAK uint8_t const * tud_descriptor_bos_cb(void);
+
+#if TUD_OPT_RHPORT_COUNT > 1
+// When both roothub ports are device, above descriptor callbacks are replaced by these ones
+// so that each port can have its own descriptors
+uint8_t const * tud_n_descriptor_device_cb(uint8_t rhport);
+uint8_t const * tud_n_descriptor_configuration_cb(uint8_t rhport, uint8_t index);
+uint16_t const* tud_n_descriptor_string_cb(uint8_t rhport, uint8_t index);
+ATTR_WEAK uint8_t const * tud_n_descriptor_device_qualifier_cb(uint8_t rhport);
+ATTR_WEAK uint8_t const * tud_n_descriptor_other_speed_configuration_cb(uint8_t rhport, uint8_t index);
+ATTR_WEAK uint8_t const * tud_n_descriptor_bos_cb(uint8_t rhport);
+#endif
+
 // Invoked when device is mounted (configured)
 ATTR_WEAK void tud_mount_cb(void);
 
@@ -88,6 +199,17 @@ ATTR_WEAK void tud_suspend_cb(bool remote_wakeup_en);
 // Invoked when usb bus is resumed
 ATTR_WEAK void tud_resume_cb(void);
 
+// Invoked when host puts the link into L1 sleep with an LPM transaction. Unlike suspend, device may keep
+// drawing current but must be able to resume within the time given by BESL (Best Effort Service Latency).
+ATTR_WEAK void tud_lpm_sleep_cb(uint8_t besl, bool remote_wakeup_en);
+
+// Invoked when link is resumed from L1 sleep
+ATTR_WEAK void tud_lpm_resume_cb(void);
+
+// Invoked by tud_task_ext() to measure its time budget
+// Application return a free running microsecond counter
+ATTR_WEAK uint32_t tud_time_us_cb(void);
+
 //--------------------------------------------------------------------+
 // Interface Descriptor Template
 //--------------------------------------------------------------------+
@@ -98,6 +220,24 @@ ATTR_WEAK void tud_resume_cb(void);
 #define TUD_CONFIG_DESCRIPTOR(_itfcount, _stridx, _total_len, _attribute, _power_ma) \
   9, TUSB_DESC_CONFIGURATION, U16_TO_U8S_LE(_total_len), _itfcount, 1, _stridx, TU_BIT(7) | _attribute, (_power_ma)/2
 
+// Same as above, for tud_descriptor_other_speed_configuration_cb() of high speed capable device
+#define TUD_OTHER_SPEED_CONFIG_DESCRIPTOR(_itfcount, _stridx, _total_len, _attribute, _power_ma) \
+  9, TUSB_DESC_OTHER_SPEED_CONFIG, U16_TO_U8S_LE(_total_len), _itfcount, 1, _stridx, TU_BIT(7) | _attribute, (_power_ma)/2
+
+//------------- BOS -------------//
+
+#define TUD_BOS_DESC_LEN          (5)
+
+// Total length, number of device capabilities
+#define TUD_BOS_DESCRIPTOR(_total_len, _caps_num) \
+  5, TUSB_DESC_BOS, U16_TO_U8S_LE(_total_len), _caps_num
+
+#define TUD_BOS_USB20_EXT_DESC_LEN  (7)
+
+// USB 2.0 Extension capability, attribute e.g TUSB_USB20_EXT_ATT_LPM
+#define TUD_BOS_USB20_EXT_DESCRIPTOR(_attribute) \
+  7, TUSB_DESC_DEVICE_CAPABILITY, DEVICE_CAPABILITY_USB20_EXTENSION, U32_TO_U8S_LE(_attribute)
+
 //------------- CDC -------------//
 
 // Length of template descriptor: 66 bytes
@@ -171,6 +311,23 @@ ATTR_WEAK void tud_resume_cb(void);
   /* Endpoint Out */\
   7, TUSB_DESC_ENDPOINT, _epout, TUSB_XFER_INTERRUPT, U16_TO_U8S_LE(_epsize), _ep_interval
 
+//------------- Custom (Vendor) -------------//
+
+// Length of template descriptor: 32 bytes
+#define TUD_CUSTOM_ALT_DESC_LEN    (9 + 9 + 7 + 7)
+
+// Vendor interface with zero bandwidth default setting (alt 0) and alt 1 with a bulk endpoint pair
+// Interface number, string index, EP Out & EP In address, EP size
+#define TUD_CUSTOM_ALT_DESCRIPTOR(_itfnum, _stridx, _epout, _epin, _epsize) \
+  /* Interface alt 0: no endpoint */\
+  9, TUSB_DESC_INTERFACE, _itfnum, 0, 0, TUSB_CLASS_VENDOR_SPECIFIC, 0, 0, _stridx,\
+  /* Interface alt 1 */\
+  9, TUSB_DESC_INTERFACE, _itfnum, 1, 2, TUSB_CLASS_VENDOR_SPECIFIC, 0, 0, _stridx,\
+  /* Endpoint Out */\
+  7, TUSB_DESC_ENDPOINT, _epout, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0,\
+  /* Endpoint In */\
+  7, TUSB_DESC_ENDPOINT, _epin, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0
+
 #ifdef __cplusplus
  }
 #endif
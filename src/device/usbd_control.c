@@ -30,6 +30,7 @@
 
 #include "tusb.h"
 #include "device/usbd_pvt.h"
+#include "device/usbd_trace.h"
 
 enum
 {
@@ -45,60 +46,140 @@ typedef struct
   uint16_t total_len;
   uint16_t total_transferred;
 
+  bool zero_copy; // whole data stage is transferred directly from/to buffer
+  volatile bool replied; // data or status stage is already started for current request
+  uint8_t seq;     // incremented for each SETUP and bus reset, ties deferred reply to its request
+
+  // Deferred reply from tud_control_reply()/tud_control_stall(), carried out by usbd task
+  struct {
+    void* buffer;
+    uint16_t len;
+    bool stall;
+    volatile bool claimed; // reply for current request is already deferred
+  } reply;
+
   bool (*complete_cb) (uint8_t, tusb_control_request_t const *);
 } usbd_control_xfer_t;
 
-static usbd_control_xfer_t _control_state;
+static usbd_control_xfer_t _control_state[TUD_OPT_RHPORT_COUNT];
+
+CFG_TUSB_MEM_SECTION CFG_TUSB_MEM_ALIGN uint8_t _usbd_ctrl_buf[TUD_OPT_RHPORT_COUNT][CFG_TUD_ENDOINT0_SIZE];
 
-CFG_TUSB_MEM_SECTION CFG_TUSB_MEM_ALIGN uint8_t _usbd_ctrl_buf[CFG_TUD_ENDOINT0_SIZE];
+static inline usbd_control_xfer_t* get_ctrl(uint8_t rhport)
+{
+  return &_control_state[usbd_rhport_idx(rhport)];
+}
 
 void usbd_control_reset (uint8_t rhport)
 {
-  (void) rhport;
-  tu_varclr(&_control_state);
+  usbd_control_xfer_t* p_ctrl = get_ctrl(rhport);
+
+  // keep sequence running, reply deferred before the reset must not answer a later request
+  uint8_t const seq = p_ctrl->seq;
+
+  tu_varclr(p_ctrl);
+  p_ctrl->seq = (uint8_t) (seq + 1);
+}
+
+// Invoked by usbd when a SETUP is received, before it is dispatched
+void usbd_control_set_request(uint8_t rhport, tusb_control_request_t const * request)
+{
+  usbd_control_xfer_t* p_ctrl = get_ctrl(rhport);
+
+  p_ctrl->request = (*request);
+  p_ctrl->seq++;
+  p_ctrl->replied = false;
+  p_ctrl->reply.claimed = false;
 }
 
 bool usbd_control_status(uint8_t rhport, tusb_control_request_t const * request)
 {
+  usbd_control_xfer_t* p_ctrl = get_ctrl(rhport);
+
+  p_ctrl->replied = true;
+
   // status direction is reversed to one in the setup packet
-  return dcd_edpt_xfer(rhport, request->bmRequestType_bit.direction ? EDPT_CTRL_OUT : EDPT_CTRL_IN, NULL, 0);
+  uint8_t const ep_addr = request->bmRequestType_bit.direction ? EDPT_CTRL_OUT : EDPT_CTRL_IN;
+  TUD_TRACE(TUD_TRACE_CTRL_STATUS, ep_addr, 0);
+
+  return dcd_edpt_xfer(rhport, ep_addr, NULL, 0);
+}
+
+// Check if data stage can be carried out directly with caller's buffer as one multi-packet transfer
+static bool control_zero_copy(void const* buffer, uint16_t len)
+{
+#if TUD_OPT_DCD_DMA_ANY_BUFFER
+  // Small payload is probably in caller's stack (e.g GET_STATUS), copying it is cheap anyway
+  if ( len <= CFG_TUD_ENDOINT0_SIZE ) return false;
+
+  #if CFG_TUSB_MCU == OPT_MCU_NRF5X
+  // EasyDMA can only access Data RAM, but descriptors are usually in flash
+  return ((uintptr_t) buffer) >= 0x20000000UL;
+  #else
+  (void) buffer;
+  return true;
+  #endif
+#else
+  (void) buffer;
+  (void) len;
+  return false;
+#endif
 }
 
 // Each transaction is up to endpoint0's max packet size
 static bool start_control_data_xact(uint8_t rhport)
 {
-  uint16_t const xact_len = tu_min16(_control_state.total_len - _control_state.total_transferred, CFG_TUD_ENDOINT0_SIZE);
+  usbd_control_xfer_t* p_ctrl = get_ctrl(rhport);
+
+  uint8_t* ctrl_buf = _usbd_ctrl_buf[usbd_rhport_idx(rhport)];
+  uint16_t const xact_len = tu_min16(p_ctrl->total_len - p_ctrl->total_transferred, CFG_TUD_ENDOINT0_SIZE);
 
   uint8_t ep_addr = EDPT_CTRL_OUT;
 
-  if ( _control_state.request.bmRequestType_bit.direction == TUSB_DIR_IN )
+  if ( p_ctrl->request.bmRequestType_bit.direction == TUSB_DIR_IN )
   {
     ep_addr = EDPT_CTRL_IN;
-    memcpy(_usbd_ctrl_buf, _control_state.buffer, xact_len);
+    memcpy(ctrl_buf, p_ctrl->buffer, xact_len);
   }
 
-  return dcd_edpt_xfer(rhport, ep_addr, _usbd_ctrl_buf, xact_len);
+  TUD_TRACE(TUD_TRACE_CTRL_DATA, ep_addr, xact_len);
+  return dcd_edpt_xfer(rhport, ep_addr, ctrl_buf, xact_len);
 }
 
 // TODO may find a better way
-void usbd_control_set_complete_callback( bool (*fp) (uint8_t, tusb_control_request_t const * ) )
+void usbd_control_set_complete_callback(uint8_t rhport, bool (*fp) (uint8_t, tusb_control_request_t const * ) )
 {
-  _control_state.complete_cb = fp;
+  usbd_control_xfer_t* p_ctrl = get_ctrl(rhport);
+
+  p_ctrl->complete_cb = fp;
 }
 
 bool usbd_control_xfer(uint8_t rhport, tusb_control_request_t const * request, void* buffer, uint16_t len)
 {
-  _control_state.request = (*request);
-  _control_state.buffer = buffer;
-  _control_state.total_len = tu_min16(len, request->wLength);
-  _control_state.total_transferred = 0;
+  usbd_control_xfer_t* p_ctrl = get_ctrl(rhport);
+
+  p_ctrl->replied = true;
+  p_ctrl->request = (*request);
+  p_ctrl->buffer = buffer;
+  p_ctrl->total_len = tu_min16(len, request->wLength);
+  p_ctrl->total_transferred = 0;
+  p_ctrl->zero_copy = control_zero_copy(buffer, p_ctrl->total_len);
 
   if ( len )
   {
     TU_ASSERT(buffer);
 
     // Data stage
-    TU_ASSERT( start_control_data_xact(rhport) );
+    if ( p_ctrl->zero_copy )
+    {
+      uint8_t const ep_addr = request->bmRequestType_bit.direction ? EDPT_CTRL_IN : EDPT_CTRL_OUT;
+      TUD_TRACE(TUD_TRACE_CTRL_DATA, ep_addr, p_ctrl->total_len);
+
+      TU_ASSERT( dcd_edpt_xfer(rhport, ep_addr, (uint8_t*) buffer, p_ctrl->total_len) );
+    }else
+    {
+      TU_ASSERT( start_control_data_xact(rhport) );
+    }
   }else
   {
     // Status stage
@@ -111,34 +192,38 @@ bool usbd_control_xfer(uint8_t rhport, tusb_control_request_t const * request, v
 // callback when a transaction complete on DATA stage of control endpoint
 bool usbd_control_xfer_cb (uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes)
 {
+  usbd_control_xfer_t* p_ctrl = get_ctrl(rhport);
+
   (void) result;
   (void) ep_addr;
 
-  if ( _control_state.request.bmRequestType_bit.direction == TUSB_DIR_OUT )
+  if ( !p_ctrl->zero_copy && (p_ctrl->request.bmRequestType_bit.direction == TUSB_DIR_OUT) )
   {
-    TU_VERIFY(_control_state.buffer);
-    memcpy(_control_state.buffer, _usbd_ctrl_buf, xferred_bytes);
+    TU_VERIFY(p_ctrl->buffer);
+    uint8_t const* ctrl_buf = _usbd_ctrl_buf[usbd_rhport_idx(rhport)];
+    memcpy(p_ctrl->buffer, ctrl_buf, xferred_bytes);
   }
 
-  _control_state.total_transferred += xferred_bytes;
-  _control_state.buffer += xferred_bytes;
+  p_ctrl->total_transferred += xferred_bytes;
+  p_ctrl->buffer += xferred_bytes;
 
-  if ( _control_state.total_len == _control_state.total_transferred || xferred_bytes < CFG_TUD_ENDOINT0_SIZE )
+  // zero-copy transfer completes the whole data stage at once, either fully or ended by a short packet
+  if ( p_ctrl->zero_copy || p_ctrl->total_len == p_ctrl->total_transferred || xferred_bytes < CFG_TUD_ENDOINT0_SIZE )
   {
     // DATA stage is complete
     bool is_ok = true;
 
     // invoke complete callback if set
     // callback can still stall control in status phase e.g out data does not make sense
-    if ( _control_state.complete_cb )
+    if ( p_ctrl->complete_cb )
     {
-      is_ok = _control_state.complete_cb(rhport, &_control_state.request);
+      is_ok = p_ctrl->complete_cb(rhport, &p_ctrl->request);
     }
 
     if ( is_ok )
     {
       // Send status
-      TU_ASSERT( usbd_control_status(rhport, &_control_state.request) );
+      TU_ASSERT( usbd_control_status(rhport, &p_ctrl->request) );
     }else
     {
       // Stall both IN and OUT control endpoint
@@ -155,4 +240,81 @@ bool usbd_control_xfer_cb (uint8_t rhport, uint8_t ep_addr, xfer_result_t result
   return true;
 }
 
+//--------------------------------------------------------------------+
+// Deferred Reply
+//--------------------------------------------------------------------+
+
+// Run in usbd task to serialize with SETUP processing. Param carries rhport and the sequence
+// number of the request being answered.
+static void control_reply_task(void* param)
+{
+  uint8_t const rhport = (uint8_t) ((uintptr_t) param & 0xff);
+  uint8_t const seq    = (uint8_t) ((uintptr_t) param >> 8);
+  usbd_control_xfer_t* p_ctrl = get_ctrl(rhport);
+
+  // skip if request was aborted by a new SETUP or bus reset, or already answered
+  if ( (seq != p_ctrl->seq) || p_ctrl->replied ) return;
+
+  if ( p_ctrl->reply.stall )
+  {
+    p_ctrl->replied = true;
+    dcd_edpt_stall(rhport, EDPT_CTRL_OUT);
+    dcd_edpt_stall(rhport, EDPT_CTRL_IN);
+  }else
+  {
+    usbd_control_xfer(rhport, &p_ctrl->request, p_ctrl->reply.buffer, p_ctrl->reply.len);
+  }
+}
+
+uint8_t tud_control_token(uint8_t rhport)
+{
+  // only meaningful in usbd task while request is being dispatched
+  return get_ctrl(rhport)->seq;
+}
+
+// Claim the reply of request identified by token and defer it to usbd task, only the first claim succeeds
+static bool control_reply_defer(uint8_t rhport, uint8_t token, void* buffer, uint16_t len, bool stall, bool in_isr)
+{
+  usbd_control_xfer_t* p_ctrl = get_ctrl(rhport);
+
+  // usb isr can't preempt itself, only mask it when called from other context
+  if ( !in_isr ) dcd_int_disable(rhport);
+
+  bool const claimed = (token == p_ctrl->seq) && !(p_ctrl->replied || p_ctrl->reply.claimed);
+
+  if ( claimed )
+  {
+    p_ctrl->reply.claimed = true;
+    p_ctrl->reply.buffer  = buffer;
+    p_ctrl->reply.len     = len;
+    p_ctrl->reply.stall   = stall;
+  }
+
+  if ( !in_isr ) dcd_int_enable(rhport);
+
+  TU_VERIFY(claimed);
+
+  if ( !usbd_defer_func(control_reply_task, (void*) (uintptr_t) (((uint32_t) token << 8) | rhport), in_isr) )
+  {
+    // event queue is full, give up the claim so that caller can try again
+    if ( !in_isr ) dcd_int_disable(rhport);
+    if ( token == p_ctrl->seq ) p_ctrl->reply.claimed = false;
+    if ( !in_isr ) dcd_int_enable(rhport);
+
+    return false;
+  }
+
+  return true;
+}
+
+bool tud_control_reply(uint8_t rhport, uint8_t token, void* buffer, uint16_t len, bool in_isr)
+{
+  return control_reply_defer(rhport, token, buffer, len, false, in_isr);
+}
+
+bool tud_control_stall(uint8_t rhport, uint8_t token, bool in_isr)
+{
+  return control_reply_defer(rhport, token, NULL, 0, true, in_isr);
+}
+
 #endif
@@ -38,6 +38,12 @@
 //--------------------------------------------------------------------+
 bool usbd_init (void);
 
+// Index of device roothub port in per-port state arrays, device ports are consecutive from TUD_OPT_RHPORT
+static inline uint8_t usbd_rhport_idx(uint8_t rhport)
+{
+  return (uint8_t) (rhport - TUD_OPT_RHPORT);
+}
+
 // Carry out Data and Status stage of control transfer
 // - If len = 0, it is equivalent to sending status only
 // - If len > wLength : it will be truncated
@@ -46,16 +52,42 @@ bool usbd_control_xfer(uint8_t rhport, tusb_control_request_t const * request, v
 // Send STATUS (zero length) packet
 bool usbd_control_status(uint8_t rhport, tusb_control_request_t const * request);
 
+// Submit a transfer, or queue it if one is already in progress on the endpoint.
+// Queued transfers are started from the transfer complete path, each has its own complete callback.
+// Return false if queue is full (CFG_TUD_EDPT_XFER_QUEUE_SZ)
+bool usbd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t total_bytes);
+
+// Check if a transfer submitted by usbd_edpt_xfer() is in progress
+bool usbd_edpt_busy(uint8_t rhport, uint8_t ep_addr);
+
+// Subscribe class driver (identified by its class code) to SOF, its sof() is then invoked by usbd task
+// once per frame (frames are skipped if task is late). Subscription ends with bus reset.
+// DCD SOF interrupt is only enabled while there is a subscriber.
+void usbd_sof_enable(uint8_t rhport, uint8_t class_code, bool en);
+
+// Close endpoint e.g when switching alternate setting, transfers in progress or queued are dropped.
+// Endpoint can then be opened again with dcd_edpt_open().
+void usbd_edpt_close(uint8_t rhport, uint8_t ep_addr);
+
 void usbd_edpt_stall(uint8_t rhport, uint8_t ep_addr);
 void usbd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr);
 bool usbd_edpt_stalled(uint8_t rhport, uint8_t ep_addr);
 
+// Invoke class driver's xfer_cb directly from dcd_event_handler() (usually ISR) for this endpoint
+// instead of deferring to tud_task(). Driver's callback for it must therefore be ISR-safe.
+// Registration is cleared by bus reset.
+void usbd_edpt_isr_dispatch(uint8_t rhport, uint8_t ep_addr, bool enable);
+
 /*------------------------------------------------------------------*/
 /* Helper
  *------------------------------------------------------------------*/
 
+// Get interface descriptor of an alternate setting in current configuration, NULL if not found.
+// Used by driver's set_interface() to open endpoints of the newly selected setting.
+tusb_desc_interface_t const* usbd_desc_itf_get(uint8_t rhport, uint8_t itf_num, uint8_t alt);
+
 bool usbd_open_edpt_pair(uint8_t rhport, uint8_t const* p_desc, uint8_t ep_count, uint8_t xfer_type, uint8_t* ep_out, uint8_t* ep_in);
-void usbd_defer_func( osal_task_func_t func, void* param, bool in_isr );
+bool usbd_defer_func( osal_task_func_t func, void* param, bool in_isr );
 
 
 #ifdef __cplusplus
@@ -0,0 +1,117 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+/* Device stack tracing
+ * Timestamped records of event/transfer/control stage are written to a binary ring buffer, which is
+ * also a SEGGER RTT up channel. Stream it with e.g
+ *   JLinkRTTLogger -Device <device> -If SWD -Speed 4000 -RTTChannel 1 trace.bin
+ * then decode with tools/usbd_trace.py trace.bin
+ *
+ * Enable with CFG_TUD_TRACE = 1, lib/segger_rtt must then be added to the build.
+ * When disabled, all hooks compile to nothing.
+ */
+
+#ifndef _TUSB_USBD_TRACE_H_
+#define _TUSB_USBD_TRACE_H_
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#ifndef CFG_TUD_TRACE
+#define CFG_TUD_TRACE   0
+#endif
+
+// Trace record id, must be kept in sync with tools/usbd_trace.py
+enum
+{
+  TUD_TRACE_DCD_EVENT = 1, // arg8 = dcd event id, arg16 = endpoint address (xfer complete)
+  TUD_TRACE_QUEUE_SEND,    // arg8 = dcd event id, arg16 = 1 if queued, 0 if dropped
+  TUD_TRACE_QUEUE_RECV,    // arg8 = dcd event id
+  TUD_TRACE_XFER_CB_ENTER, // arg8 = endpoint address, arg16 = xferred bytes
+  TUD_TRACE_XFER_CB_EXIT,  // arg8 = endpoint address
+  TUD_TRACE_CTRL_SETUP,    // arg8 = bRequest, arg16 = wLength
+  TUD_TRACE_CTRL_DATA,     // arg8 = endpoint address, arg16 = length
+  TUD_TRACE_CTRL_STATUS,   // arg8 = endpoint address
+};
+
+#if CFG_TUD_TRACE
+
+#include "SEGGER_RTT.h"
+
+// RTT up channel used for tracing, channel 0 is normally used for terminal
+#ifndef CFG_TUD_TRACE_RTT_CHANNEL
+#define CFG_TUD_TRACE_RTT_CHANNEL   1
+#endif
+
+// Ring buffer size in bytes, each record is 8 bytes
+#ifndef CFG_TUD_TRACE_BUFSIZE
+#define CFG_TUD_TRACE_BUFSIZE       1024
+#endif
+
+// Timestamp of a record, could be defined as cycle counter e.g DWT->CYCCNT for better resolution
+#ifndef CFG_TUD_TRACE_TIMESTAMP
+#define CFG_TUD_TRACE_TIMESTAMP()   (tud_time_us_cb ? tud_time_us_cb() : 0)
+#endif
+
+typedef struct
+{
+  uint32_t timestamp;
+  uint8_t  id;
+  uint8_t  arg8;
+  uint16_t arg16;
+} usbd_trace_record_t;
+
+TU_VERIFY_STATIC(sizeof(usbd_trace_record_t) == 8, "size is not correct");
+
+void usbd_trace_init(void);
+
+static inline void usbd_trace(uint8_t id, uint8_t arg8, uint16_t arg16)
+{
+  usbd_trace_record_t rec = { .id = id, .arg8 = arg8, .arg16 = arg16 };
+
+  // Timestamp is taken with lock held so that records are written in time order
+  SEGGER_RTT_LOCK();
+  rec.timestamp = CFG_TUD_TRACE_TIMESTAMP();
+  SEGGER_RTT_WriteNoLock(CFG_TUD_TRACE_RTT_CHANNEL, &rec, sizeof(rec));
+  SEGGER_RTT_UNLOCK();
+}
+
+#define TUD_TRACE_INIT()                 usbd_trace_init()
+#define TUD_TRACE(_id, _arg8, _arg16)    usbd_trace(_id, (uint8_t) (_arg8), (uint16_t) (_arg16))
+
+#else
+
+#define TUD_TRACE_INIT()
+#define TUD_TRACE(_id, _arg8, _arg16)
+
+#endif
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* _TUSB_USBD_TRACE_H_ */
@@ -62,6 +62,11 @@ typedef void (*osal_task_func_t)( void * );
 //--------------------------------------------------------------------+
 static inline void osal_task_delay(uint32_t msec);
 
+#if CFG_TUSB_OS != OPT_OS_NONE
+// Milliseconds since scheduler start, wraps around. Only RTOS ports provide it (used for blocking API)
+static inline uint32_t osal_time_millis(void);
+#endif
+
 //------------- Semaphore -------------//
 static inline osal_semaphore_t osal_semaphore_create(osal_semaphore_def_t* semdef);
 static inline bool osal_semaphore_post(osal_semaphore_t sem_hdl, bool in_isr);
@@ -77,7 +82,9 @@ static inline bool osal_mutex_unlock(osal_mutex_t mutex_hdl);
 //------------- Queue -------------//
 static inline osal_queue_t osal_queue_create(osal_queue_def_t* qdef);
 static inline bool osal_queue_receive(osal_queue_t const qhdl, void* data);
+static inline uint16_t osal_queue_receive_n(osal_queue_t const qhdl, void* data, uint16_t n); // up to n items, blocking for 1st one only
 static inline bool osal_queue_send(osal_queue_t const qhdl, void const * data, bool in_isr);
+static inline bool osal_queue_empty(osal_queue_t const qhdl); // non blocking, to check before receiving
 
 #if 0  // TODO remove subtask related macros later
 // Sub Task
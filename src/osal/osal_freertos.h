@@ -45,6 +45,12 @@ static inline void osal_task_delay(uint32_t msec)
   vTaskDelay( pdMS_TO_TICKS(msec) );
 }
 
+static inline uint32_t osal_time_millis(void)
+{
+  // portTICK_PERIOD_MS is 0 with tick rate above 1 kHz
+  return (uint32_t) ( ((uint64_t) xTaskGetTickCount() * 1000) / configTICK_RATE_HZ );
+}
+
 //--------------------------------------------------------------------+
 // Semaphore API
 //--------------------------------------------------------------------+
@@ -109,23 +115,45 @@ typedef struct
   void*    buf;
 
   StaticQueue_t sq;
+  QueueHandle_t hdl;
 }osal_queue_def_t;
 
-typedef QueueHandle_t osal_queue_t;
+typedef osal_queue_def_t* osal_queue_t;
 
 static inline osal_queue_t osal_queue_create(osal_queue_def_t* qdef)
 {
-  return xQueueCreateStatic(qdef->depth, qdef->item_sz, (uint8_t*) qdef->buf, &qdef->sq);
+  qdef->hdl = xQueueCreateStatic(qdef->depth, qdef->item_sz, (uint8_t*) qdef->buf, &qdef->sq);
+  return qdef->hdl ? qdef : NULL;
+}
+
+static inline bool osal_queue_receive(osal_queue_t const qhdl, void* data)
+{
+  return xQueueReceive(qhdl->hdl, data, portMAX_DELAY);
+}
+
+// Block for the 1st item only, then take whatever is already queued without blocking
+static inline uint16_t osal_queue_receive_n(osal_queue_t const qhdl, void* data, uint16_t n)
+{
+  uint8_t* p_data = (uint8_t*) data;
+  uint16_t count = 0;
+
+  while ( (count < n) && xQueueReceive(qhdl->hdl, p_data, count ? 0 : portMAX_DELAY) )
+  {
+    count++;
+    p_data += qhdl->item_sz;
+  }
+
+  return count;
 }
 
-static inline bool osal_queue_receive(osal_queue_t const queue_hdl, void* data)
+static inline bool osal_queue_send(osal_queue_t const qhdl, void const * data, bool in_isr)
 {
-  return xQueueReceive(queue_hdl, data, portMAX_DELAY);
+  return in_isr ? xQueueSendToBackFromISR(qhdl->hdl, data, NULL) : xQueueSendToBack(qhdl->hdl, data, OSAL_TIMEOUT_WAIT_FOREVER);
 }
 
-static inline bool osal_queue_send(osal_queue_t const queue_hdl, void const * data, bool in_isr)
+static inline bool osal_queue_empty(osal_queue_t const qhdl)
 {
-  return in_isr ? xQueueSendToBackFromISR(queue_hdl, data, NULL) : xQueueSendToBack(queue_hdl, data, OSAL_TIMEOUT_WAIT_FOREVER);
+  return uxQueueMessagesWaiting(qhdl->hdl) == 0;
 }
 
 #ifdef __cplusplus
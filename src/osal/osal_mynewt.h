@@ -41,6 +41,11 @@ static inline void osal_task_delay(uint32_t msec)
   os_time_delay( os_time_ms_to_ticks32(msec) );
 }
 
+static inline uint32_t osal_time_millis(void)
+{
+  return os_time_ticks_to_ms32( os_time_get() );
+}
+
 //--------------------------------------------------------------------+
 // Semaphore API
 //--------------------------------------------------------------------+
@@ -125,18 +130,45 @@ static inline osal_queue_t osal_queue_create(osal_queue_def_t* qdef)
   return (osal_queue_t) qdef;
 }
 
+// copy message out of an event and put back its blocks
+static inline void _osal_q_take_event(osal_queue_t const qhdl, struct os_event* ev, void* data)
+{
+  memcpy(data, ev->ev_arg, qhdl->item_sz); // copy message
+  os_memblock_put(&qhdl->mpool, ev->ev_arg); // put back mem block
+  os_memblock_put(&qhdl->epool, ev);         // put back ev block
+}
+
 static inline bool osal_queue_receive(osal_queue_t const qhdl, void* data)
 {
   struct os_event* ev;
   ev = os_eventq_get(&qhdl->evq);
 
-  memcpy(data, ev->ev_arg, qhdl->item_sz); // copy message
-  os_memblock_put(&qhdl->mpool, ev->ev_arg); // put back mem block
-  os_memblock_put(&qhdl->epool, ev);         // put back ev block
+  _osal_q_take_event(qhdl, ev, data);
 
   return true;
 }
 
+// Block for the 1st item only, then take whatever is already queued without blocking
+static inline uint16_t osal_queue_receive_n(osal_queue_t const qhdl, void* data, uint16_t n)
+{
+  if ( n == 0 ) return 0;
+
+  uint8_t* p_data = (uint8_t*) data;
+  uint16_t count = 0;
+  struct os_event* ev = os_eventq_get(&qhdl->evq);
+
+  while ( ev )
+  {
+    _osal_q_take_event(qhdl, ev, p_data);
+    count++;
+    p_data += qhdl->item_sz;
+
+    ev = (count < n) ? os_eventq_get_no_wait(&qhdl->evq) : NULL;
+  }
+
+  return count;
+}
+
 static inline bool osal_queue_send(osal_queue_t const qhdl, void const * data, bool in_isr)
 {
   (void) in_isr;
@@ -161,6 +193,11 @@ static inline bool osal_queue_send(osal_queue_t const qhdl, void const * data, b
   return true;
 }
 
+static inline bool osal_queue_empty(osal_queue_t const qhdl)
+{
+  return STAILQ_EMPTY(&qhdl->evq.evq_list);
+}
+
 #ifdef __cplusplus
  }
 #endif
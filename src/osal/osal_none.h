@@ -146,7 +146,11 @@ typedef osal_queue_def_t* osal_queue_t;
 static inline void _osal_q_lock(osal_queue_t qhdl)
 {
 #if TUSB_OPT_DEVICE_ENABLED
-  if (qhdl->role == OPT_MODE_DEVICE) dcd_int_disable(TUD_OPT_RHPORT);
+  if (qhdl->role == OPT_MODE_DEVICE)
+  {
+    // all device ports share the same event queue
+    for(uint8_t i=0; i<TUD_OPT_RHPORT_COUNT; i++) dcd_int_disable(TUD_OPT_RHPORT+i);
+  }
 #endif
 
 #if TUSB_OPT_HOST_ENABLED
@@ -158,7 +162,11 @@ static inline void _osal_q_lock(osal_queue_t qhdl)
 static inline void _osal_q_unlock(osal_queue_t qhdl)
 {
 #if TUSB_OPT_DEVICE_ENABLED
-  if (qhdl->role == OPT_MODE_DEVICE) dcd_int_enable(TUD_OPT_RHPORT);
+  if (qhdl->role == OPT_MODE_DEVICE)
+  {
+    // all device ports share the same event queue
+    for(uint8_t i=0; i<TUD_OPT_RHPORT_COUNT; i++) dcd_int_enable(TUD_OPT_RHPORT+i);
+  }
 #endif
 
 #if TUSB_OPT_HOST_ENABLED
@@ -173,17 +181,22 @@ static inline osal_queue_t osal_queue_create(osal_queue_def_t* qdef)
 }
 
 // non blocking
+// Queue has only one consumer (the stack task) and fifo is lock-free against the ISR producer,
+// therefore there is no need to disable usb isr here.
 static inline bool osal_queue_receive(osal_queue_t const qhdl, void* data)
 {
-  _osal_q_lock(qhdl);
-  bool success = tu_fifo_read(&qhdl->ff, data);
-  _osal_q_unlock(qhdl);
+  return tu_fifo_read(&qhdl->ff, data);
+}
 
-  return success;
+// non blocking, up to n items at once
+static inline uint16_t osal_queue_receive_n(osal_queue_t const qhdl, void* data, uint16_t n)
+{
+  return tu_fifo_read_n(&qhdl->ff, data, n);
 }
 
 static inline bool osal_queue_send(osal_queue_t const qhdl, void const * data, bool in_isr)
 {
+  // Sending from task context races with the ISR producer, lock to serialize them
   if (!in_isr) {
     _osal_q_lock(qhdl);
   }
@@ -197,6 +210,11 @@ static inline bool osal_queue_send(osal_queue_t const qhdl, void const * data, b
   return success;
 }
 
+static inline bool osal_queue_empty(osal_queue_t const qhdl)
+{
+  return tu_fifo_empty(&qhdl->ff);
+}
+
 #ifdef __cplusplus
  }
 #endif
@@ -81,7 +81,38 @@ void dcd_init (uint8_t rhport)
   while (USB->DEVICE.SYNCBUSY.bit.ENABLE == 1) {}
 
   USB->DEVICE.INTFLAG.reg |= USB->DEVICE.INTFLAG.reg; // clear pending
-  USB->DEVICE.INTENSET.reg = USB_DEVICE_INTENSET_SOF | USB_DEVICE_INTENSET_EORST;
+  USB->DEVICE.INTENSET.reg = USB_DEVICE_INTENSET_EORST;
+}
+
+void dcd_sof_enable(uint8_t rhport, bool en)
+{
+  (void) rhport;
+
+  if ( en )
+  {
+    USB->DEVICE.INTFLAG.reg  = USB_DEVICE_INTFLAG_SOF;
+    USB->DEVICE.INTENSET.reg = USB_DEVICE_INTENSET_SOF;
+  }else
+  {
+    USB->DEVICE.INTENCLR.reg = USB_DEVICE_INTENCLR_SOF;
+  }
+}
+
+void dcd_lpm_enable(uint8_t rhport, bool en)
+{
+  (void) rhport;
+
+  if ( en )
+  {
+    // acknowledge LPM token, then LPMSUSP is raised once link enters L1
+    USB->DEVICE.CTRLB.bit.LPMHDSK = USB_DEVICE_CTRLB_LPMHDSK_ACK_Val;
+    USB->DEVICE.INTFLAG.reg  = USB_DEVICE_INTFLAG_LPMSUSP;
+    USB->DEVICE.INTENSET.reg = USB_DEVICE_INTENSET_LPMSUSP;
+  }else
+  {
+    USB->DEVICE.CTRLB.bit.LPMHDSK = USB_DEVICE_CTRLB_LPMHDSK_NO_Val;
+    USB->DEVICE.INTENCLR.reg = USB_DEVICE_INTENCLR_LPMSUSP;
+  }
 }
 
 void dcd_int_enable(uint8_t rhport)
@@ -328,6 +359,20 @@ void USB_Handler(void)
     dcd_event_bus_signal(0, DCD_EVENT_SUSPEND, true);
   }
 
+  // Link entered L1 sleep after LPM token is acknowledged
+  if ( int_status & USB_DEVICE_INTFLAG_LPMSUSP )
+  {
+    USB->DEVICE.INTFLAG.reg = USB_DEVICE_INTFLAG_LPMSUSP;
+
+    // Enable wakeup interrupt to detect resume from L1, which is reported as normal resume
+    USB->DEVICE.INTFLAG.reg = USB_DEVICE_INTFLAG_WAKEUP; // clear pending
+    USB->DEVICE.INTENSET.reg = USB_DEVICE_INTFLAG_WAKEUP;
+
+    // LPM token's bmAttributes is stored in EP0 bank: bLinkState[3:0], BESL[7:4], bRemoteWake[8]
+    uint16_t const attr = sram_registers[0][0].EXTREG.bit.VARIABLE;
+    dcd_event_lpm_sleep(0, (uint8_t) ((attr >> 4) & 0x0f), tu_bit_test(attr, 8), true);
+  }
+
   // Wakeup interrupt is only enabled when we got suspended.
   // Wakeup interrupt will disable itself
   if ( int_status & USB_DEVICE_INTFLAG_WAKEUP )
@@ -60,6 +60,9 @@ CFG_TUSB_MEM_SECTION ATTR_ALIGNED(2048) static dcd_data_t dcd_data1;
 
 static LPC_USBHS_T * const LPC_USB[2] = { LPC_USB0, LPC_USB1 };
 
+// Bus reset is reported when port is enabled again with its negotiated speed
+static volatile bool _bus_reset_pending[2];
+
 static dcd_data_t* const dcd_data_ptr[2] =
 {
 #if (CFG_TUSB_RHPORT0_MODE & OPT_MODE_DEVICE)
@@ -130,12 +133,31 @@ void dcd_init(uint8_t rhport)
 
   lpc_usb->ENDPOINTLISTADDR = (uint32_t) p_dcd->qhd; // Endpoint List Address has to be 2K alignment
   lpc_usb->USBSTS_D  = lpc_usb->USBSTS_D;
-  lpc_usb->USBINTR_D = INT_MASK_USB | INT_MASK_ERROR | INT_MASK_PORT_CHANGE | INT_MASK_RESET | INT_MASK_SUSPEND | INT_MASK_SOF;
+  lpc_usb->USBINTR_D = INT_MASK_USB | INT_MASK_ERROR | INT_MASK_PORT_CHANGE | INT_MASK_RESET | INT_MASK_SUSPEND;
+
+  // Stay at full speed unless port is configured as high speed
+  uint8_t const rhport_mode = (rhport == 0) ? CFG_TUSB_RHPORT0_MODE : CFG_TUSB_RHPORT1_MODE;
+  if ( !(rhport_mode & OPT_MODE_HIGH_SPEED) ) lpc_usb->PORTSC1_D |= PORTSC_FORCE_FULL_SPEED_MASK;
 
   lpc_usb->USBCMD_D &= ~0x00FF0000; // Interrupt Threshold Interval = 0
   lpc_usb->USBCMD_D |= TU_BIT(0); // connect
 }
 
+// SOF interrupt is raised every micro-frame (125 us) in high speed
+void dcd_sof_enable(uint8_t rhport, bool en)
+{
+  LPC_USBHS_T* const lpc_usb = LPC_USB[rhport];
+
+  if ( en )
+  {
+    lpc_usb->USBSTS_D   = INT_MASK_SOF; // clear pending
+    lpc_usb->USBINTR_D |= INT_MASK_SOF;
+  }else
+  {
+    lpc_usb->USBINTR_D &= ~INT_MASK_SOF;
+  }
+}
+
 void dcd_int_enable(uint8_t rhport)
 {
   NVIC_EnableIRQ(rhport ? USB1_IRQn : USB0_IRQn);
@@ -240,6 +262,23 @@ bool dcd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const * p_endpoint_desc)
   return true;
 }
 
+void dcd_edpt_close(uint8_t rhport, uint8_t ep_addr)
+{
+  LPC_USBHS_T* const lpc_usb = LPC_USB[rhport];
+
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  uint8_t const dir   = tu_edpt_dir(ep_addr);
+  uint8_t const shift = dir ? 16 : 0;
+
+  // Disable endpoint, its type is set back to bulk (as bus reset) since unused direction must not be control
+  lpc_usb->ENDPTCTRL[epnum] = (lpc_usb->ENDPTCTRL[epnum] & ~(0xFFFFUL << shift)) | ((TUSB_XFER_BULK << 2) << shift);
+
+  // Flush primed buffer if any
+  uint32_t const ep_mask = TU_BIT(epnum + shift);
+  lpc_usb->ENDPTFLUSH = ep_mask;
+  while (lpc_usb->ENDPTFLUSH & ep_mask);
+}
+
 bool dcd_edpt_busy(uint8_t rhport, uint8_t ep_addr)
 {
   uint8_t const epnum  = tu_edpt_number(ep_addr);
@@ -296,7 +335,18 @@ void hal_dcd_isr(uint8_t rhport)
   if (int_status & INT_MASK_RESET)
   {
     bus_reset(rhport);
-    dcd_event_bus_signal(rhport, DCD_EVENT_BUS_RESET, true);
+    _bus_reset_pending[rhport] = true;
+  }
+
+  // Port change is raised when port enters full or high speed operation after reset,
+  // speed is only valid from this point.
+  if ( (int_status & INT_MASK_PORT_CHANGE) && _bus_reset_pending[rhport] &&
+       !(lpc_usb->PORTSC1_D & PORTSC_PORT_RESET_MASK) )
+  {
+    _bus_reset_pending[rhport] = false;
+
+    tusb_speed_t const speed = (tusb_speed_t) ((lpc_usb->PORTSC1_D >> PORTSC_PORT_SPEED_SHIFT) & 0x03);
+    dcd_event_bus_reset(rhport, speed, true);
   }
 
   if (int_status & INT_MASK_SUSPEND)
@@ -73,7 +73,10 @@ enum {
 enum {
   PORTSC_CURRENT_CONNECT_STATUS_MASK = TU_BIT(0),
   PORTSC_FORCE_PORT_RESUME_MASK      = TU_BIT(6),
-  PORTSC_SUSPEND_MASK                = TU_BIT(7)
+  PORTSC_SUSPEND_MASK                = TU_BIT(7),
+  PORTSC_PORT_RESET_MASK             = TU_BIT(8),
+  PORTSC_FORCE_FULL_SPEED_MASK       = TU_BIT(24),
+  PORTSC_PORT_SPEED_SHIFT            = 26,  // 2 bits: 0 full, 1 low, 2 high speed (same as tusb_speed_t)
 };
 
 typedef struct
@@ -156,7 +156,7 @@ void dcd_init (uint8_t rhport)
   dev->DCFG |=  USB_OTG_DCFG_NZLSOHSK | (3 << USB_OTG_DCFG_DSPD_Pos);
 
   USB_OTG_FS->GINTMSK |= USB_OTG_GINTMSK_USBRST | USB_OTG_GINTMSK_ENUMDNEM | \
-    USB_OTG_GINTMSK_SOFM | USB_OTG_GINTMSK_RXFLVLM /* SB_OTG_GINTMSK_ESUSPM | \
+    USB_OTG_GINTMSK_RXFLVLM /* SB_OTG_GINTMSK_ESUSPM | \
     USB_OTG_GINTMSK_USBSUSPM */;
 
   // Enable pullup, enable peripheral.
@@ -175,6 +175,27 @@ void dcd_int_disable (uint8_t rhport)
   NVIC_DisableIRQ(OTG_FS_IRQn);
 }
 
+void dcd_sof_enable(uint8_t rhport, bool en)
+{
+  (void) rhport;
+
+  // GINTMSK is also modified by isr: keep read-modify-write atomic with a short critical section.
+  // PRIMASK is restored rather than NVIC re-enabled, caller may run with usb interrupt disabled or in isr.
+  uint32_t const primask = __get_PRIMASK();
+  __disable_irq();
+
+  if ( en )
+  {
+    USB_OTG_FS->GINTSTS  = USB_OTG_GINTSTS_SOF; // clear pending
+    USB_OTG_FS->GINTMSK |= USB_OTG_GINTMSK_SOFM;
+  }else
+  {
+    USB_OTG_FS->GINTMSK &= ~USB_OTG_GINTMSK_SOFM;
+  }
+
+  __set_PRIMASK(primask);
+}
+
 void dcd_set_address (uint8_t rhport, uint8_t dev_addr)
 {
   (void) rhport;
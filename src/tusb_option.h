@@ -95,23 +95,28 @@
   #define CFG_TUSB_RHPORT1_MODE OPT_MODE_NONE
 #endif
 
-#if ((CFG_TUSB_RHPORT0_MODE & OPT_MODE_HOST) && (CFG_TUSB_RHPORT1_MODE & OPT_MODE_HOST)) || \
-    ((CFG_TUSB_RHPORT0_MODE & OPT_MODE_DEVICE) && (CFG_TUSB_RHPORT1_MODE & OPT_MODE_DEVICE))
-  #error "tinyusb does not support same modes on more than 1 roothub port"
+#if (CFG_TUSB_RHPORT0_MODE & OPT_MODE_HOST) && (CFG_TUSB_RHPORT1_MODE & OPT_MODE_HOST)
+  #error "tinyusb does not support host mode on more than 1 roothub port"
 #endif
 
 // Which roothub port is configured as host
 #define TUH_OPT_RHPORT          ( (CFG_TUSB_RHPORT0_MODE & OPT_MODE_HOST) ? 0 : ((CFG_TUSB_RHPORT1_MODE & OPT_MODE_HOST) ? 1 : -1) )
 #define TUSB_OPT_HOST_ENABLED   ( TUH_OPT_RHPORT >= 0 )
 
-// Which roothub port is configured as device
+// Which roothub port is configured as device, the first one if both ports are device.
 #define TUD_OPT_RHPORT          ( (CFG_TUSB_RHPORT0_MODE & OPT_MODE_DEVICE) ? 0 : ((CFG_TUSB_RHPORT1_MODE & OPT_MODE_DEVICE) ? 1 : -1) )
 
-#if TUD_OPT_RHPORT == 0
-#define TUD_OPT_HIGH_SPEED      ( CFG_TUSB_RHPORT0_MODE & OPT_MODE_HIGH_SPEED )
-#else
-#define TUD_OPT_HIGH_SPEED      ( CFG_TUSB_RHPORT1_MODE & OPT_MODE_HIGH_SPEED )
-#endif
+// Number of roothub ports configured as device. Each port runs as an independent device with its own
+// state and SETUP lane, but all ports share the device task and its event queue (CFG_TUD_TASK_QUEUE_SZ):
+// a port flooding transfer events can fill the queue for the other one, size it for both.
+// Their USB interrupts must have the same priority (not preempting each other).
+#define TUD_OPT_RHPORT_COUNT    ( ((CFG_TUSB_RHPORT0_MODE & OPT_MODE_DEVICE) ? 1 : 0) + ((CFG_TUSB_RHPORT1_MODE & OPT_MODE_DEVICE) ? 1 : 0) )
+
+// Whether a roothub port is configured as high speed capable
+#define TUD_OPT_HIGH_SPEED_N(_rhport)  ( (((_rhport) == 0) ? CFG_TUSB_RHPORT0_MODE : CFG_TUSB_RHPORT1_MODE) & OPT_MODE_HIGH_SPEED )
+
+// High speed option of the first device port only, use TUD_OPT_HIGH_SPEED_N() with multiple device ports
+#define TUD_OPT_HIGH_SPEED      TUD_OPT_HIGH_SPEED_N(TUD_OPT_RHPORT)
 
 #define TUSB_OPT_DEVICE_ENABLED ( TUD_OPT_RHPORT >= 0 )
 
@@ -146,6 +151,16 @@
   #define CFG_TUD_ENDOINT0_SIZE   64
 #endif
 
+// Device controller can DMA directly from/to any buffer within CFG_TUSB_MEM_SECTION regardless
+// of alignment and length. Class drivers then transfer from/to their fifo without a bounce buffer.
+#ifndef TUD_OPT_DCD_DMA_ANY_BUFFER
+  #if CFG_TUSB_MCU == OPT_MCU_NRF5X || CFG_TUSB_MCU == OPT_MCU_LPC18XX || CFG_TUSB_MCU == OPT_MCU_LPC43XX
+    #define TUD_OPT_DCD_DMA_ANY_BUFFER  1
+  #else
+    #define TUD_OPT_DCD_DMA_ANY_BUFFER  0
+  #endif
+#endif
+
 #ifndef CFG_TUD_CDC
   #define CFG_TUD_CDC             0
 #endif
@@ -0,0 +1,212 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+/* Host micro-benchmark of tu_fifo_write_n()/tu_fifo_read_n()
+ * Streams data through a byte fifo with CDC-like packet sizes and compares against the previous
+ * item-by-item implementation (kept below as reference), which also checks both give same data.
+ *   make && ./fifo_bench
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAS_CYCLE_COUNTER 1
+#else
+#define HAS_CYCLE_COUNTER 0
+#endif
+
+#include "common/tusb_common.h"
+#include "common/tusb_fifo.h"
+
+#define FIFO_DEPTH    512
+#define TOTAL_BYTES   (64u*1024*1024)
+
+//--------------------------------------------------------------------+
+// Reference: item by item copy with modulo, as tu_fifo used to do
+//--------------------------------------------------------------------+
+typedef struct
+{
+  uint8_t* buffer;
+  uint16_t depth;
+  uint16_t item_size;
+  volatile uint16_t count;
+  volatile uint16_t wr_idx;
+  volatile uint16_t rd_idx;
+} ref_fifo_t;
+
+static bool ref_write(ref_fifo_t* f, void const* p_data)
+{
+  if ( f->count == f->depth ) return false;
+
+  memcpy(f->buffer + (f->wr_idx * f->item_size), p_data, f->item_size);
+  f->wr_idx = (f->wr_idx + 1) % f->depth;
+  f->count++;
+
+  return true;
+}
+
+static bool ref_read(ref_fifo_t* f, void* p_buffer)
+{
+  if ( f->count == 0 ) return false;
+
+  memcpy(p_buffer, f->buffer + (f->rd_idx * f->item_size), f->item_size);
+  f->rd_idx = (f->rd_idx + 1) % f->depth;
+  f->count--;
+
+  return true;
+}
+
+static uint16_t ref_write_n(ref_fifo_t* f, void const* p_data, uint16_t count)
+{
+  uint8_t const* p_buf = (uint8_t const*) p_data;
+  uint16_t len = 0;
+  while ( (len < count) && ref_write(f, p_buf) )
+  {
+    len++;
+    p_buf += f->item_size;
+  }
+  return len;
+}
+
+static uint16_t ref_read_n(ref_fifo_t* f, void* p_buffer, uint16_t count)
+{
+  uint8_t* p_buf = (uint8_t*) p_buffer;
+  uint16_t len = 0;
+  while ( (len < count) && ref_read(f, p_buf) )
+  {
+    len++;
+    p_buf += f->item_size;
+  }
+  return len;
+}
+
+//--------------------------------------------------------------------+
+// Benchmark
+//--------------------------------------------------------------------+
+static uint8_t ff_buf[FIFO_DEPTH];
+static uint8_t ref_buf[FIFO_DEPTH];
+
+static tu_fifo_t  ff;
+static ref_fifo_t ref_ff = { .buffer = ref_buf, .depth = FIFO_DEPTH, .item_size = 1 };
+
+typedef uint16_t (*write_n_t)(void* f, void const* p_data, uint16_t count);
+typedef uint16_t (*read_n_t) (void* f, void* p_buffer, uint16_t count);
+
+typedef struct
+{
+  uint64_t ns;
+  uint64_t cycles;
+  uint32_t checksum;
+} result_t;
+
+static uint64_t now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+static uint64_t now_cycles(void)
+{
+#if HAS_CYCLE_COUNTER
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+// Write then read back packets of pkt_size, read size is a bit different so that wrap point moves
+static result_t run(void* f, write_n_t write_n, read_n_t read_n, uint16_t pkt_size)
+{
+  uint8_t wr[FIFO_DEPTH];
+  uint8_t rd[FIFO_DEPTH];
+  for(uint16_t i=0; i<sizeof(wr); i++) wr[i] = (uint8_t) i;
+
+  result_t result = { 0 };
+  uint64_t const start_ns  = now_ns();
+  uint64_t const start_cyc = now_cycles();
+
+  for(uint32_t total = 0; total < TOTAL_BYTES; )
+  {
+    uint16_t const written = write_n(f, wr, pkt_size);
+    uint16_t const count   = read_n(f, rd, (uint16_t) (pkt_size - 1));
+
+    total += written;
+    result.checksum = result.checksum*31 + rd[count/2];
+  }
+
+  // drain so that next run starts from empty fifo
+  while ( read_n(f, rd, sizeof(rd)) ) {}
+
+  result.cycles = now_cycles() - start_cyc;
+  result.ns     = now_ns() - start_ns;
+
+  return result;
+}
+
+static uint16_t tu_write_n(void* f, void const* p_data, uint16_t count) { return tu_fifo_write_n((tu_fifo_t*) f, p_data, count); }
+static uint16_t tu_read_n (void* f, void* p_buffer, uint16_t count)     { return tu_fifo_read_n((tu_fifo_t*) f, p_buffer, count);  }
+static uint16_t rf_write_n(void* f, void const* p_data, uint16_t count) { return ref_write_n((ref_fifo_t*) f, p_data, count);    }
+static uint16_t rf_read_n (void* f, void* p_buffer, uint16_t count)     { return ref_read_n((ref_fifo_t*) f, p_buffer, count);   }
+
+static void print_result(char const* name, result_t const* r)
+{
+  printf("  %-10s %8.1f MB/s", name, (TOTAL_BYTES / 1e6) / (r->ns / 1e9));
+  if ( HAS_CYCLE_COUNTER ) printf("  %6.3f bytes/cycle", (double) TOTAL_BYTES / (double) r->cycles);
+  printf("\n");
+}
+
+int main(void)
+{
+  tu_fifo_config(&ff, ff_buf, FIFO_DEPTH, 1, false);
+
+  uint16_t const pkt_sizes[] = { 8, 64, 512 };
+  int rc = 0;
+
+  printf("fifo depth %u, %u MB streamed per run\n", FIFO_DEPTH, TOTAL_BYTES >> 20);
+
+  for(size_t i=0; i<sizeof(pkt_sizes)/sizeof(pkt_sizes[0]); i++)
+  {
+    result_t const before = run(&ref_ff, rf_write_n, rf_read_n, pkt_sizes[i]);
+    result_t const after  = run(&ff    , tu_write_n, tu_read_n, pkt_sizes[i]);
+
+    printf("packet %u bytes\n", pkt_sizes[i]);
+    print_result("item loop", &before);
+    print_result("tu_fifo", &after);
+
+    if ( before.checksum != after.checksum )
+    {
+      printf("  data mismatch!\n");
+      rc = 1;
+    }
+  }
+
+  return rc;
+}
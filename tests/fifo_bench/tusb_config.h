@@ -1,4 +1,4 @@
-/* 
+/*
  * The MIT License (MIT)
  *
  * Copyright (c) 2019 Ha Thach (tinyusb.org)
@@ -24,56 +24,11 @@
  * This file is part of the TinyUSB stack.
  */
 
-#include "unity.h"
-#include "fifo.h"
+#ifndef _TUSB_CONFIG_H_
+#define _TUSB_CONFIG_H_
 
-#define FIFO_SIZE 10
-TU_FIFO_DEF(ff, FIFO_SIZE, uint8_t, false);
+// Only tusb_fifo.c is built on host, no controller is used
+#define CFG_TUSB_RHPORT0_MODE     OPT_MODE_NONE
+#define CFG_TUSB_OS               OPT_OS_NONE
 
-void setUp(void)
-{
-  tu_fifo_clear(&ff);
-}
-
-void tearDown(void)
-{
-}
-
-void test_normal(void)
-{
-  uint8_t i;
-
-  for(i=0; i < FIFO_SIZE; i++)
-  {
-    tu_fifo_write(&ff, &i);
-  }
-
-  for(i=0; i < FIFO_SIZE; i++)
-  {
-    uint8_t c;
-    tu_fifo_read(&ff, &c);
-    TEST_ASSERT_EQUAL(i, c);
-  }
-}
-
-void test_is_empty(void)
-{
-  uint8_t temp;
-  TEST_ASSERT_TRUE(tu_fifo_is_empty(&ff));
-  tu_fifo_write(&ff, &temp);
-  TEST_ASSERT_FALSE(tu_fifo_is_empty(&ff));
-}
-
-void test_is_full(void)
-{
-  uint8_t i;
-
-  TEST_ASSERT_FALSE(tu_fifo_is_full(&ff));
-
-  for(i=0; i < FIFO_SIZE; i++)
-  {
-    tu_fifo_write(&ff, &i);
-  }
-
-  TEST_ASSERT_TRUE(tu_fifo_is_full(&ff));
-}
+#endif /* _TUSB_CONFIG_H_ */
@@ -0,0 +1,257 @@
+/* 
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include <string.h>
+#include <string.h>
+
+#include "unity.h"
+#include "common/tusb_common.h"
+#include "common/tusb_fifo.h"
+
+#define FIFO_SIZE 10
+TU_FIFO_DEF(ff, FIFO_SIZE, uint8_t, false);
+
+void setUp(void)
+{
+  // tu_fifo_clear() doesn't rewind indices, re-config so that every test starts at index 0
+  tu_fifo_config(&ff, ff_buf, FIFO_SIZE, sizeof(uint8_t), false);
+}
+
+void tearDown(void)
+{
+}
+
+void test_normal(void)
+{
+  uint8_t i;
+
+  for(i=0; i < FIFO_SIZE; i++)
+  {
+    tu_fifo_write(&ff, &i);
+  }
+
+  for(i=0; i < FIFO_SIZE; i++)
+  {
+    uint8_t c;
+    tu_fifo_read(&ff, &c);
+    TEST_ASSERT_EQUAL(i, c);
+  }
+}
+
+void test_is_empty(void)
+{
+  uint8_t temp;
+  TEST_ASSERT_TRUE(tu_fifo_empty(&ff));
+  tu_fifo_write(&ff, &temp);
+  TEST_ASSERT_FALSE(tu_fifo_empty(&ff));
+}
+
+void test_is_full(void)
+{
+  uint8_t i;
+
+  TEST_ASSERT_FALSE(tu_fifo_full(&ff));
+
+  for(i=0; i < FIFO_SIZE; i++)
+  {
+    tu_fifo_write(&ff, &i);
+  }
+
+  TEST_ASSERT_TRUE(tu_fifo_full(&ff));
+}
+
+void test_write_n_read_n_wrap_around(void)
+{
+  uint8_t buf[FIFO_SIZE];
+  uint8_t i;
+
+  for(i=0; i < FIFO_SIZE; i++) buf[i] = i;
+
+  // move read & write index to the middle so that next write wraps around
+  TEST_ASSERT_EQUAL(6, tu_fifo_write_n(&ff, buf, 6));
+  TEST_ASSERT_EQUAL(6, tu_fifo_read_n(&ff, buf, 6));
+
+  for(i=0; i < FIFO_SIZE; i++) buf[i] = i;
+  TEST_ASSERT_EQUAL(FIFO_SIZE, tu_fifo_write_n(&ff, buf, FIFO_SIZE));
+  TEST_ASSERT_TRUE(tu_fifo_full(&ff));
+
+  // no more room
+  TEST_ASSERT_EQUAL(0, tu_fifo_write_n(&ff, buf, 1));
+
+  uint8_t rd[FIFO_SIZE] = { 0 };
+  TEST_ASSERT_EQUAL(FIFO_SIZE, tu_fifo_read_n(&ff, rd, FIFO_SIZE+5));
+  TEST_ASSERT_EQUAL_MEMORY(buf, rd, FIFO_SIZE);
+  TEST_ASSERT_TRUE(tu_fifo_empty(&ff));
+}
+
+void test_write_n_partial(void)
+{
+  uint8_t buf[FIFO_SIZE+4] = { 0 };
+
+  TEST_ASSERT_EQUAL(FIFO_SIZE, tu_fifo_write_n(&ff, buf, FIFO_SIZE+4));
+  TEST_ASSERT_EQUAL(FIFO_SIZE, tu_fifo_count(&ff));
+}
+
+void test_full_empty_after_many_wrap(void)
+{
+  uint8_t buf[FIFO_SIZE] = { 0 };
+
+  // index runs through [0, 2*depth) several times
+  for(uint8_t i=0; i < 5; i++)
+  {
+    TEST_ASSERT_EQUAL(FIFO_SIZE-3, tu_fifo_write_n(&ff, buf, FIFO_SIZE-3));
+    TEST_ASSERT_EQUAL(3, tu_fifo_write_n(&ff, buf, FIFO_SIZE));
+    TEST_ASSERT_TRUE(tu_fifo_full(&ff));
+    TEST_ASSERT_EQUAL(0, tu_fifo_remaining(&ff));
+
+    TEST_ASSERT_EQUAL(FIFO_SIZE, tu_fifo_read_n(&ff, buf, FIFO_SIZE));
+    TEST_ASSERT_TRUE(tu_fifo_empty(&ff));
+  }
+}
+
+void test_read_write_info_wrap_around(void)
+{
+  uint8_t buf[FIFO_SIZE] = { 0 };
+  tu_fifo_buffer_info_t info;
+
+  tu_fifo_write_n(&ff, buf, 7);
+  tu_fifo_read_n(&ff, buf, 7);
+
+  // free space: 3 linear + 7 wrapped
+  tu_fifo_get_write_info(&ff, &info);
+  TEST_ASSERT_EQUAL(3, info.len_lin);
+  TEST_ASSERT_EQUAL(7, info.len_wrap);
+  TEST_ASSERT_EQUAL_PTR(ff_buf + 7, info.ptr_lin);
+  TEST_ASSERT_EQUAL_PTR(ff_buf, info.ptr_wrap);
+
+  memset(info.ptr_lin, 0xAA, info.len_lin);
+  memset(info.ptr_wrap, 0xBB, 2);
+  tu_fifo_advance_write_pointer(&ff, info.len_lin + 2);
+  TEST_ASSERT_EQUAL(5, tu_fifo_count(&ff));
+
+  tu_fifo_get_read_info(&ff, &info);
+  TEST_ASSERT_EQUAL(3, info.len_lin);
+  TEST_ASSERT_EQUAL(2, info.len_wrap);
+  TEST_ASSERT_EQUAL_HEX8(0xAA, ((uint8_t*) info.ptr_lin)[0]);
+  TEST_ASSERT_EQUAL_HEX8(0xBB, ((uint8_t*) info.ptr_wrap)[0]);
+
+  tu_fifo_advance_read_pointer(&ff, 5);
+  TEST_ASSERT_TRUE(tu_fifo_empty(&ff));
+}
+
+void test_peek_n_and_find_wrap_around(void)
+{
+  uint8_t buf[FIFO_SIZE] = { 0 };
+  uint8_t const frame[] = { 'a', 'b', 'c', 'd', '\n', 'e' };
+  uint16_t pos;
+
+  // frame terminator lands after the wrap point
+  tu_fifo_write_n(&ff, buf, 7);
+  tu_fifo_read_n(&ff, buf, 7);
+  tu_fifo_write_n(&ff, frame, sizeof(frame));
+
+  TEST_ASSERT_TRUE(tu_fifo_find(&ff, '\n', &pos));
+  TEST_ASSERT_EQUAL(4, pos);
+  TEST_ASSERT_TRUE(tu_fifo_find(&ff, 'a', &pos));
+  TEST_ASSERT_EQUAL(0, pos);
+  TEST_ASSERT_FALSE(tu_fifo_find(&ff, 'z', &pos));
+
+  uint8_t rd[FIFO_SIZE] = { 0 };
+  TEST_ASSERT_EQUAL(sizeof(frame), tu_fifo_peek_n(&ff, rd, FIFO_SIZE));
+  TEST_ASSERT_EQUAL_MEMORY(frame, rd, sizeof(frame));
+  TEST_ASSERT_EQUAL(sizeof(frame), tu_fifo_count(&ff));
+}
+
+// fill n items of a region, which could be wrapped around
+static void fill_region(tu_fifo_buffer_info_t const* info, uint8_t value, uint16_t n)
+{
+  uint16_t const lin = tu_min16(n, info->len_lin);
+
+  memset(info->ptr_lin, value, lin);
+  if ( n > lin ) memset(info->ptr_wrap, value, n - lin);
+}
+
+void test_reserve_commit_in_order(void)
+{
+  uint8_t buf[FIFO_SIZE] = { 0 };
+  tu_fifo_buffer_info_t info1, info2;
+
+  // first reservation wraps around: 3 linear + 1 wrapped
+  tu_fifo_write_n(&ff, buf, 7);
+  tu_fifo_read_n(&ff, buf, 7);
+
+  TEST_ASSERT_TRUE(tu_fifo_reserve(&ff, 4, &info1));
+  TEST_ASSERT_EQUAL(3, info1.len_lin);
+  TEST_ASSERT_EQUAL(1, info1.len_wrap);
+  TEST_ASSERT_TRUE(tu_fifo_reserve(&ff, 4, &info2));
+
+  // all or nothing
+  TEST_ASSERT_FALSE(tu_fifo_reserve(&ff, 3, &info2));
+
+  fill_region(&info2, 2, 4);
+  tu_fifo_commit(&ff);
+
+  // not published until the earlier reservation is committed
+  TEST_ASSERT_TRUE(tu_fifo_empty(&ff));
+
+  fill_region(&info1, 1, 4);
+  tu_fifo_commit(&ff);
+  TEST_ASSERT_EQUAL(8, tu_fifo_count(&ff));
+
+  uint8_t const expected[8] = { 1, 1, 1, 1, 2, 2, 2, 2 };
+  uint8_t rd[8];
+  tu_fifo_read_n(&ff, rd, 8);
+  TEST_ASSERT_EQUAL_MEMORY(expected, rd, 8);
+}
+
+TU_FIFO_TYPED_DEF(tff, 8, uint32_t);
+
+void test_typed_fifo(void)
+{
+  tff_clear();
+
+  for(uint32_t i=0; i < 8; i++)
+  {
+    TEST_ASSERT_TRUE(tff_write(&i));
+  }
+
+  uint32_t value = 0xff;
+  TEST_ASSERT_FALSE(tff_write(&value));
+  TEST_ASSERT_TRUE(tff_full());
+
+  TEST_ASSERT_TRUE(tff_read(&value));
+  TEST_ASSERT_EQUAL(0, value);
+
+  // wrap around with block write
+  uint32_t const wr[3] = { 100, 101, 102 };
+  TEST_ASSERT_EQUAL(1, tff_write_n(wr, 3));
+
+  uint32_t rd[8];
+  TEST_ASSERT_EQUAL(8, tff_read_n(rd, 8));
+  TEST_ASSERT_EQUAL(1, rd[0]);
+  TEST_ASSERT_EQUAL(100, rd[7]);
+  TEST_ASSERT_TRUE(tff_empty());
+}
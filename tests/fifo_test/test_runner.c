@@ -0,0 +1,61 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Ha Thach (tinyusb.org)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include "unity.h"
+
+// Test runner of test_fifo.c, add new test case here
+void setUp(void);
+void tearDown(void);
+
+void test_normal(void);
+void test_is_empty(void);
+void test_is_full(void);
+void test_write_n_read_n_wrap_around(void);
+void test_write_n_partial(void);
+void test_full_empty_after_many_wrap(void);
+void test_read_write_info_wrap_around(void);
+void test_peek_n_and_find_wrap_around(void);
+void test_reserve_commit_in_order(void);
+void test_typed_fifo(void);
+
+int main(void)
+{
+  Unity.TestFile = "test_fifo.c";
+  UnityBegin();
+
+  RUN_TEST(test_normal, 0);
+  RUN_TEST(test_is_empty, 0);
+  RUN_TEST(test_is_full, 0);
+  RUN_TEST(test_write_n_read_n_wrap_around, 0);
+  RUN_TEST(test_write_n_partial, 0);
+  RUN_TEST(test_full_empty_after_many_wrap, 0);
+  RUN_TEST(test_read_write_info_wrap_around, 0);
+  RUN_TEST(test_peek_n_and_find_wrap_around, 0);
+  RUN_TEST(test_reserve_commit_in_order, 0);
+  RUN_TEST(test_typed_fifo, 0);
+
+  return UnityEnd();
+}
@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+#
+# Decode device stack trace (CFG_TUD_TRACE) streamed from SEGGER RTT channel into a timeline
+#   usage: usbd_trace.py trace.bin [--tick-hz 1000000]
+#
+# Each record is 8 bytes little endian: timestamp (u32), id (u8), arg8 (u8), arg16 (u16).
+# Record ids must be kept in sync with src/device/usbd_trace.h
+
+import argparse
+import struct
+import sys
+
+DCD_EVENTS = {
+    1: "BUS_RESET",
+    2: "UNPLUGGED",
+    3: "SOF",
+    4: "SUSPEND",
+    5: "RESUME",
+    6: "LPM_SLEEP",
+    7: "LPM_RESUME",
+    8: "SETUP_RECEIVED",
+    9: "XFER_COMPLETE",
+    10: "FUNC_CALL",
+}
+
+
+def event_name(eid):
+    return DCD_EVENTS.get(eid, "EVENT_{}".format(eid))
+
+
+def ep_name(ep_addr):
+    return "EP{:d}{}".format(ep_addr & 0x0f, "IN" if ep_addr & 0x80 else "OUT")
+
+
+RECORDS = {
+    1: ("DCD_EVENT",     lambda a8, a16: event_name(a8) + (" " + ep_name(a16) if a8 == 9 else "")),
+    2: ("QUEUE_SEND",    lambda a8, a16: event_name(a8) + ("" if a16 else " DROPPED")),
+    3: ("QUEUE_RECV",    lambda a8, a16: event_name(a8)),
+    4: ("XFER_CB_ENTER", lambda a8, a16: "{} len = {}".format(ep_name(a8), a16)),
+    5: ("XFER_CB_EXIT",  lambda a8, a16: ep_name(a8)),
+    6: ("CTRL_SETUP",    lambda a8, a16: "bRequest = 0x{:02x} wLength = {}".format(a8, a16)),
+    7: ("CTRL_DATA",     lambda a8, a16: "{} len = {}".format(ep_name(a8), a16)),
+    8: ("CTRL_STATUS",   lambda a8, a16: ep_name(a8)),
+}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode tinyusb device trace")
+    parser.add_argument("file", help="binary dump of trace RTT channel")
+    parser.add_argument("--tick-hz", type=int, default=1000000, help="timestamp frequency, default is microsecond")
+    args = parser.parse_args()
+
+    with open(args.file, "rb") as f:
+        data = f.read()
+
+    if len(data) % 8:
+        print("warning: ignore {} trailing bytes".format(len(data) % 8), file=sys.stderr)
+
+    start = None
+    prev = None
+    for timestamp, rid, arg8, arg16 in struct.iter_unpack("<IBBH", data[:len(data) - len(data) % 8]):
+        if start is None:
+            start = prev = timestamp
+
+        # timestamp is free running 32-bit, wrap around is handled by masking
+        elapsed = ((timestamp - start) & 0xffffffff) * 1e6 / args.tick_hz
+        delta = ((timestamp - prev) & 0xffffffff) * 1e6 / args.tick_hz
+        prev = timestamp
+
+        name, decode = RECORDS.get(rid, ("UNKNOWN_{}".format(rid), lambda a8, a16: "{} {}".format(a8, a16)))
+        print("{:12.1f} us  +{:9.1f}  {:<14} {}".format(elapsed, delta, name, decode(arg8, arg16)))
+
+
+if __name__ == "__main__":
+    main()